@@ -0,0 +1,60 @@
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "types.h"
+#include "memory.h"
+
+// Bulk assembler: a single pass over a text buffer (typically a mapped file)
+// that never allocates and never exits, and only prints its per-line trace
+// at --log=debug. Every program file is loaded through it. It accepts the
+// syntax of the old parser, so valid programs assemble to the same words,
+// but malformed lines are reported with their line number instead of
+// aborting the process. It keeps the low 6 bits of a register number or
+// value that does not fit its field (STR R1 100 stores to address 36).
+//
+// One buffer may hold many programs. A directive line
+//
+//     .program <name>
+//
+// starts a new program; text before the first directive (or a buffer
+// without any) is a single unnamed program.
+
+typedef enum
+{
+    ASM_END,     // No programs left in the buffer
+    ASM_PROGRAM, // A program was assembled
+    ASM_ERROR    // A program had an error; the scanner moved on to the next one
+} asm_status_t;
+
+typedef struct
+{
+    int line;            // Line of the error, counted from the start of the buffer
+    const char *message; // Static description
+} asm_error_t;
+
+typedef struct
+{
+    instruction_word_t words[INSTR_MEMORY_SIZE];
+    uint16_t count;    // Number of instructions
+    const char *name;  // Name from the .program directive (points into the buffer), or NULL
+    size_t name_size;  // Bytes of name
+    int line;          // First line of the program
+} asm_program_t;
+
+typedef struct
+{
+    const char *cursor; // Start of the next line to scan
+    const char *end;
+    int line;           // Number of the next line
+} asm_scanner_t;
+
+// Function to start scanning a buffer of assembly text
+void asm_init(asm_scanner_t *scanner, const char *text, size_t size);
+
+// Function to assemble the next program of the buffer; on ASM_ERROR the
+// first error of the program is in error and the rest of it is skipped
+asm_status_t asm_next_program(asm_scanner_t *scanner, asm_program_t *program, asm_error_t *error);
+
+#endif // ASSEMBLER_H
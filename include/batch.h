@@ -0,0 +1,63 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+#include "types.h"
+#include "sim.h"
+
+// Batch runner: executes a manifest of (program, configuration) jobs on a
+// pool of worker threads, one machine per worker.
+//
+// Manifest format, one job per line:
+//
+//     <program path> [--mode=...] [--max-cycles=N] [--predictor=...] [--btb=N] [--cosim]
+//
+// Blank lines and lines starting with '#' are ignored. Options are the same
+// as on the command line. Each distinct program is assembled (or loaded from
+// its object file) once and the image is shared by every job that runs it.
+// With an archive, program names are looked up in its index instead.
+//
+// Jobs are dealt out to the workers in contiguous chunks. Each worker takes
+// its own jobs from the back of its deque and, once that is empty, steals
+// from the front of the other workers' deques.
+
+#define BATCH_MAX_THREADS 256
+
+typedef enum
+{
+    BATCH_OK,         // Ran to completion
+    BATCH_LIMIT,      // Stopped by --max-cycles before the program ended
+    BATCH_LOAD_ERROR, // The program could not be loaded
+    BATCH_DIVERGED,   // --cosim found the pipeline disagreeing with the reference
+    BATCH_FAULT,      // The program accessed memory out of bounds (m->fault)
+    BATCH_SKIPPED     // No worker could create a machine to run it
+} batch_status_t;
+
+typedef struct
+{
+    char *program;        // Program path as written in the manifest
+    sim_config_t config;  // Options for this job
+    int image;            // Index into the batch's image table
+    int line;             // Manifest line, for the report
+} batch_job_t;
+
+typedef struct
+{
+    batch_status_t status;
+    long long cycles;          // Simulated cycles (estimated in ISA-level modes)
+    long long retired;         // Retired instructions
+    long long taken_branches;  // Taken branches
+    long long branches;        // Branches resolved by the pipeline (0 in ISA-level modes)
+    long long mispredictions;  // ... that the predictor got wrong
+    instruction_word_t pc;     // Final program counter
+    data_word_t sreg;          // Final status register
+    uint32_t state_hash;       // FNV-1a hash of registers, SREG and data memory
+} batch_result_t;
+
+// Function to run every job in a manifest on the given number of threads
+// (0: one per online processor) and print the aggregated report; programs
+// come from the archive at archive_path if it is not NULL (object.h)
+// Returns 0 if every job loaded and ran (without diverging or faulting), 1 otherwise
+int run_batch(const char *manifest_path, const char *archive_path, int threads);
+
+#endif // BATCH_H
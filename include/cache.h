@@ -0,0 +1,106 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+
+// Set-associative cache timing model for the pipeline. The memories stay
+// the single source of truth; a cache only tracks which lines it holds, so
+// it decides how many cycles an access takes and never changes a result.
+//
+// The I-cache sits in front of fetch and the D-cache in front of LDR/STR.
+// Sizes are in bytes; an instruction word is 2 bytes. A miss costs
+// miss_latency cycles. Write-back caches allocate on a store miss and pay
+// another miss_latency when they evict a dirty line. Write-through caches
+// send every store to memory, paying miss_latency each time (there is no
+// write buffer), and do not allocate on a store miss.
+//
+// A size of 0 turns a cache off: every access takes a single cycle, as the
+// memories did before caches were modelled.
+
+typedef enum
+{
+    CACHE_LRU, // Evict the least recently used way
+    CACHE_PLRU // Tree pseudo-LRU: one bit per node of a binary tree over the ways
+} cache_replacement_t;
+
+typedef enum
+{
+    CACHE_WRITE_BACK,
+    CACHE_WRITE_THROUGH
+} cache_write_policy_t;
+
+#define CACHE_MAX_LINES 1024 // Largest cache: CACHE_MAX_LINES lines of any size
+#define CACHE_MAX_WAYS 16
+#define CACHE_MAX_LINE_SIZE 256
+#define CACHE_MAX_LATENCY 1000
+#define CACHE_DEFAULT_LINE_SIZE 16
+#define CACHE_DEFAULT_LATENCY 10
+#define INSTRUCTION_BYTES 2 // I-cache byte address of an instruction: PC * INSTRUCTION_BYTES
+
+typedef struct
+{
+    uint32_t size;         // Bytes (0: no cache); a power of two
+    uint16_t line_size;    // Bytes; a power of two
+    uint16_t ways;         // Lines per set; a power of two (1: direct mapped)
+    uint8_t replacement;   // cache_replacement_t
+    uint8_t write_policy;  // cache_write_policy_t
+    uint16_t miss_latency; // Extra cycles per miss
+} cache_config_t;
+
+typedef struct
+{
+    uint64_t last_use; // Access count at the last hit or fill (LRU)
+    uint32_t tag;
+    uint8_t valid;
+    uint8_t dirty;
+    uint16_t reserved;
+} cache_line_t;
+
+typedef struct
+{
+    cache_config_t config;
+    uint32_t sets;
+    uint8_t offset_bits;
+    uint8_t set_bits;
+    uint64_t accesses;                  // Clock for the LRU stamps
+    cache_line_t lines[CACHE_MAX_LINES]; // sets * ways, set by set
+    uint16_t plru[CACHE_MAX_LINES];      // Tree bits per set (bit n is node n, root 1)
+} cache_t;
+
+// Per-cache counters, kept with the pipeline's performance counters
+typedef struct
+{
+    long long hits;
+    long long misses;
+    long long evictions;     // Valid lines replaced by a fill
+    long long memory_writes; // Dirty lines written back, or stores written through
+    long long stall_cycles;  // Cycles the pipeline waited on this cache
+} cache_counters_t;
+
+// Function to fill a configuration with the defaults for an enabled cache
+// of the given size
+void cache_default_config(cache_config_t *config, uint32_t size);
+
+// Function to parse a cache specification: "off", or comma-separated
+// size=N, line=N, ways=N, replace=lru|plru, write=back|through, latency=N;
+// returns 1 if it is valid
+int parse_cache_config(const char *spec, cache_config_t *config);
+
+// Function to check a configuration's geometry; returns 1 if it is valid
+int cache_config_valid(const cache_config_t *config);
+
+// Function to configure a cache and invalidate every line
+void cache_init(cache_t *cache, const cache_config_t *config);
+
+// Function to invalidate every line, keeping the configuration
+void cache_reset(cache_t *cache);
+
+// Function to look up a byte address, filling the line on a miss; returns
+// the extra cycles the access takes (0 on a hit or with the cache off)
+int cache_access(cache_t *cache, cache_counters_t *counters, uint32_t address, int write);
+
+// Function to describe a cache configuration into buffer, e.g.
+// "1024B, 16B lines, 2-way lru, write-back, 10-cycle misses"
+const char *cache_describe(const cache_config_t *config, char *buffer, int size);
+
+#endif // CACHE_H
@@ -0,0 +1,139 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include "types.h"
+#include "memory.h"
+#include "queue.h"
+#include "machine.h"
+
+// Binary checkpoints of a whole machine: architectural state, both memories,
+// the pipeline latches with their hazard/forward flags, EX.result, the stall
+// and stop counters, the issue width and depth, the cycle count, the scoreboard, the branch
+// predictor with its tables, the cache models and the performance counters. Restoring one and continuing
+// gives exactly the run the saved machine would have had.
+//
+// File layout (host byte order, checked on restore):
+//
+//     checkpoint_header_t   magic, version, geometry, payload size, checksum
+//     checkpoint_state_t    fixed-layout payload
+//     checkpoint_page_t     data_pages written data memory pages, in address order
+//
+// The payload has no pointers and no compiler-dependent types, so restore
+// maps the file and copies straight out of it. Data memory pages that were
+// never written are all zeros and are left out.
+
+#define CHECKPOINT_MAGIC "SIMCKPT"   // 8 bytes including the terminator
+#define CHECKPOINT_VERSION 8         // Bump whenever checkpoint_state_t changes
+#define CHECKPOINT_BYTE_ORDER 0x01020304u
+#define CHECKPOINT_COUNTERS (sizeof(perf_counters_t) / sizeof(long long)) // 64-bit counters in perf_counters_t
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;   // CHECKPOINT_BYTE_ORDER as written by the saving host
+    uint32_t header_size;  // sizeof(checkpoint_header_t)
+    uint32_t payload_size; // sizeof(checkpoint_state_t)
+    uint16_t reg_count;    // Geometry of the saving build, checked on restore
+    uint16_t instr_memory_size;
+    uint16_t latch_capacity;
+    uint16_t data_page_size;
+    uint32_t data_memory_size; // Data memory of the saved machine, restored with it
+    uint32_t data_pages;       // Pages stored after the payload
+    uint32_t checksum;         // FNV-1a of the payload and the pages
+} checkpoint_header_t;
+
+typedef struct
+{
+    uint32_t page; // Address / DATA_PAGE_SIZE
+    int8_t data[DATA_PAGE_SIZE];
+} checkpoint_page_t;
+
+typedef struct
+{
+    uint16_t instr;
+    uint16_t pc;
+    uint16_t predicted_pc;
+    uint8_t predicted_taken;
+    uint8_t reserved;
+} checkpoint_if_id_t;
+
+typedef struct
+{
+    uint16_t instruction;
+    uint16_t pc;
+    uint8_t opcode;
+    uint8_t r1, r2;
+    int8_t r1_value, r2_value;
+    int8_t immediate;
+    uint8_t data_hazard;
+    uint8_t r1_forward;
+    uint8_t r2_forward;
+    uint8_t predicted_taken;
+    uint16_t predicted_pc;
+} checkpoint_id_ex_t;
+
+typedef struct
+{
+    uint32_t size; // cache_config_t
+    uint16_t line_size;
+    uint16_t ways;
+    uint8_t replacement;
+    uint8_t write_policy;
+    uint16_t miss_latency;
+    uint64_t accesses;
+    cache_line_t lines[CACHE_MAX_LINES];
+    uint16_t plru[CACHE_MAX_LINES];
+} checkpoint_cache_t;
+
+typedef struct
+{
+    int64_t cycle;
+    int32_t decode_stall;
+    int32_t execute_stall;
+    int32_t stop;
+    int32_t sys_call;
+    int32_t fetch_ready_cycle;
+    int32_t memory_stall;
+    uint16_t pc;
+    int8_t sreg;
+    int8_t ex_result;
+    uint8_t if_id_count; // Latch entries, oldest first
+    uint8_t id_ex_count;
+    uint8_t issue_width;
+    uint8_t stages;
+    uint8_t ex_mem_count; // Empty unless stages is 5
+    uint8_t mem_wb_count;
+    uint16_t reserved;
+    checkpoint_if_id_t if_id[QUEUE_CAPACITY];
+    checkpoint_id_ex_t id_ex[QUEUE_CAPACITY];
+    checkpoint_id_ex_t ex_mem[QUEUE_CAPACITY];
+    checkpoint_id_ex_t mem_wb[QUEUE_CAPACITY];
+    int8_t registers[REG_COUNT];
+    uint16_t instr_memory[INSTR_MEMORY_SIZE];
+    int32_t ready_cycle[REG_COUNT]; // Scoreboard
+    int32_t written_cycle[REG_COUNT];
+    uint16_t producer_pc[REG_COUNT];
+    int8_t bypass[REG_COUNT];
+    uint8_t predictor_kind;
+    uint8_t reserved_predictor;
+    uint16_t predictor_entries;
+    uint16_t btb_entries;
+    uint8_t predictor_counters[PREDICTOR_MAX_COUNTERS];
+    btb_entry_t btb[PREDICTOR_MAX_BTB];
+    checkpoint_cache_t icache;
+    checkpoint_cache_t dcache;
+    int64_t counters[CHECKPOINT_COUNTERS]; // perf_counters_t, in field order
+} checkpoint_state_t;
+
+// Function to write the machine's full state to a checkpoint file
+// Returns 1 on success, 0 on failure (with an error on stderr)
+int checkpoint_save(const machine_t *m, const char *file_path);
+
+// Function to replace the machine's state with a checkpoint file
+// Returns 1 on success, 0 on failure (with an error on stderr; the machine
+// is left unchanged)
+int checkpoint_restore(machine_t *m, const char *file_path);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,74 @@
+#ifndef COSIM_H
+#define COSIM_H
+
+#include <stdio.h>
+#include "types.h"
+#include "machine.h"
+
+// Lockstep co-simulation: a reference machine runs the functional engine
+// (functional.h) next to the pipeline model, one instruction for every
+// instruction the pipeline retires. After each retirement the two must
+// agree on the retired instruction's address and word, the registers and
+// SREG, and for a store the byte it wrote; when the pipeline drains the
+// reference must have reached the end of the program too, with the same
+// data memory. The run stops at the first divergence. With an issue width
+// above 1 the checks run once per cycle, after the group that retired in it
+// (the identity check is on its last instruction).
+//
+// A check is a 64-byte register compare plus a few scalar ones, so a run
+// costs about one functional step per retired instruction on top of the
+// pipeline.
+
+typedef enum
+{
+    COSIM_OK,           // No divergence so far
+    COSIM_INSTRUCTION,  // The pipeline retired a different instruction
+    COSIM_STATE,        // Registers, SREG or a stored byte differ after it
+    COSIM_END,          // One side reached the end of the program first
+    COSIM_MEMORY        // Data memory differs once the pipeline drained
+} cosim_status_t;
+
+typedef struct
+{
+    cosim_status_t status;
+    long long retirement;                     // Retirements checked before it
+    int cycle;                                // Pipeline cycle it showed up in
+    instruction_word_t pc;                    // Address of the instruction the pipeline retired
+    instruction_word_t reference_pc;          // ... and of the one the reference executed
+    instruction_word_t instruction;
+    instruction_word_t reference_instruction;
+    uint16_t address;                         // Data address that differs (store or COSIM_MEMORY)
+} cosim_divergence_t;
+
+typedef struct
+{
+    machine_t *reference;          // Machine the functional engine steps
+    long long retired;             // Retirements checked so far
+    cosim_divergence_t divergence; // First divergence (status COSIM_OK: none yet)
+} cosim_t;
+
+// Function to create a co-simulation with an empty reference machine;
+// returns NULL on failure
+cosim_t *cosim_create(void);
+
+// Function to free a co-simulation
+void cosim_destroy(cosim_t *cosim);
+
+// Function to copy the pipeline machine's program and architectural state
+// into the reference, which starts at the oldest instruction still in
+// flight; call after loading (or restoring) the machine, before running it
+void cosim_start(cosim_t *cosim, machine_t *m);
+
+// Function to run the pipeline like sim_run, checking every retirement
+// against the reference; stops after the cycle of the first divergence.
+// Returns the number of cycles simulated
+long long cosim_run(cosim_t *cosim, machine_t *m, long long max_cycles);
+
+// Function to check whether the run has diverged
+int cosim_diverged(const cosim_t *cosim);
+
+// Function to print a compact report of the divergence: where it happened
+// and only the state that differs
+void cosim_print_divergence(const cosim_t *cosim, machine_t *m, FILE *file);
+
+#endif // COSIM_H
@@ -0,0 +1,44 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdio.h>
+#include "types.h"
+#include "isa.h"
+#include "cache.h"
+
+// Performance counters of the pipeline model. They are plain increments on
+// paths the pipeline already takes, so they are always on; reset_pipeline()
+// clears them and checkpoints carry them.
+typedef struct
+{
+    long long cycles;                             // Pipeline cycles simulated
+    long long retired;                            // Instructions executed
+    long long decode_stall_cycles;                // Cycles decode spent in a branch bubble
+    long long execute_stall_cycles;               // Cycles execute spent in a branch bubble
+    long long branches;                           // BEQZ and BR resolved in execute
+    long long taken_branches;                     // ... that were taken
+    long long flushes;                            // ... that were mispredicted (each flushes the pipeline)
+    long long squashed;                           // Fetched or decoded instructions thrown away by flushes
+    long long data_hazards;                       // Instructions issued with an operand still in flight
+    long long r1_forwards;                        // ... R1 operands taken off the bypass
+    long long r2_forwards;                        // ... R2 operands taken off the bypass
+    long long ex_mem_forwards;                    // Forwarded operands from the instruction just ahead
+    long long mem_wb_forwards;                    // ... from one further back (5-stage pipeline)
+    long long avoided_stall_cycles;               // Decode stalls the bypass saved (scoreboard.h)
+    long long data_stall_cycles;                  // Cycles decode waited for an operand anyway
+    long long issued;                             // Instructions decode passed to execute (squashed ones too)
+    long long dependency_splits;                  // Issue groups ended early by an operand from within the group
+    long long structural_splits;                  // ... by a second memory access or MUL
+    cache_counters_t icache;                      // Instruction cache (cache.h)
+    cache_counters_t dcache;                      // Data cache
+    long long opcode_retired[ISA_OPCODE_SLOTS];   // Retired instructions per opcode
+} perf_counters_t;
+
+// Function to write the machine's counters as one line of JSON (loads,
+// stores, CPI and branch prediction accuracy are derived from the counters)
+void counters_write_json(const machine_t *m, FILE *file);
+
+// Function to print the counters as a human-readable table
+void counters_print(const machine_t *m);
+
+#endif // COUNTERS_H
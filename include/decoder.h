@@ -11,16 +11,16 @@
 #define REG_BITS 6
 #define IMMEDIATE_BITS 6
 
-extern queue if_id_queue; // Instruction Fetch to Decode stage
-extern queue id_ex_queue; // Decode to Execute stage
-
 // Function to check if instruction is R-Format
 int isit_r_format(uint8_t opcode);
 // Function to check if instruction needs sign extension for immediate
 int needs_sign_extension(uint8_t opcode);
 
-// Function to decode an instruction
-extern void decode_stage();
+// Function to extract the static fields of an instruction word into a micro-op
+void predecode_instruction(instruction_word_t instruction, decoded_instr_t *uop);
+
+// Function to decode up to the issue width of instructions (one group)
+extern void decode_stage(machine_t *m);
 
 // Function to get opcode mnemonic string
 const char *get_opcode_mnemonic(uint8_t opcode);
@@ -0,0 +1,15 @@
+#ifndef FILE_MAP_H
+#define FILE_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Read-only view of a whole file: mmap on Unix hosts, a heap copy elsewhere
+
+// Function to map a file; returns NULL if it cannot be opened, mapped or is empty
+const uint8_t *map_file(const char *file_path, size_t *size);
+
+// Function to release a view returned by map_file
+void unmap_file(const uint8_t *data, size_t size);
+
+#endif // FILE_MAP_H
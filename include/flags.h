@@ -0,0 +1,86 @@
+#ifndef FLAGS_H
+#define FLAGS_H
+
+#include <stdint.h>
+#include "types.h"
+#include "machine.h"
+#include "instruction_map.h"
+
+// Lazy SREG. No instruction reads the flags, so an ALU instruction only
+// records itself (opcode, operands and unwrapped result) and SREG is built
+// when something looks at it: a dump, a checkpoint, a trace or another
+// engine. m->SREG holds the flags up to, but not including, the pending
+// operation; m->flags_written is the set of bits that operation writes (0:
+// nothing pending, which is also the state of a zeroed machine).
+//
+// A new operation folds the pending one into m->SREG first only if it
+// leaves some of the pending bits standing, or reads S: S becomes N xor the
+// previous S. So runs of N/Z-only instructions (MUL, ANDI, EOR, SAL, SAR)
+// never compute a flag.
+//
+// Read SREG with read_sreg and set it with write_sreg; m->SREG on its own
+// is only current after sync_sreg.
+
+// Function to apply one flag-producing operation to sreg; bit-identical to
+// setting C, V, N, S and Z one after the other as the ISA table lists them
+static inline data_word_t apply_flags(data_word_t sreg, uint8_t written, uint8_t opcode, int8_t destination,
+                                      int8_t source, int16_t result)
+{
+    int8_t wrapped = (int8_t)result;
+    int negative = wrapped < 0;
+    int overflow = 0;
+    if (opcode == ADD)
+        overflow = (destination > 0 && source > 0 && wrapped < 0) || (destination < 0 && source < 0 && wrapped > 0);
+    else if (opcode == SUB)
+        overflow = (destination < 0 && source > 0 && wrapped > 0) || (destination > 0 && source < 0 && wrapped < 0);
+
+    uint8_t bits = (uint8_t)(((result > 127 || result < 0) ? SREG_C : 0) | (overflow ? SREG_V : 0) |
+                             (negative ? SREG_N : 0) | (wrapped == 0 ? SREG_Z : 0));
+    // The sign flag is the new N xor the S bit being replaced
+    bits |= (uint8_t)(((negative ^ (((uint8_t)sreg & SREG_S) != 0))) ? SREG_S : 0);
+    return (data_word_t)(((uint8_t)sreg & (uint8_t)~written) | (bits & written));
+}
+
+// Function to get SREG, including the pending operation
+static inline data_word_t read_sreg(const machine_t *m)
+{
+    if (m->flags_written == 0)
+        return m->SREG;
+    return apply_flags(m->SREG, m->flags_written, m->flags_opcode, m->flags_destination, m->flags_source,
+                       m->flags_result);
+}
+
+// Function to fold the pending operation into m->SREG
+static inline void sync_sreg(machine_t *m)
+{
+    m->SREG = read_sreg(m);
+    m->flags_written = 0;
+}
+
+// Function to set SREG, dropping the pending operation
+static inline void write_sreg(machine_t *m, data_word_t value)
+{
+    m->SREG = value;
+    m->flags_written = 0;
+}
+
+// Function to record the SREG flags produced by an ALU instruction
+static inline void update_flags(machine_t *m, Instruction instruction, int8_t destination, int8_t source,
+                                int16_t result)
+{
+    uint8_t written = isa_table[instruction & 0xF].flags;
+
+    // Bits the new operation keeps (S counts: it is read) come from the
+    // pending one, so that one has to be folded in first
+    uint8_t kept = (uint8_t)(~written | (written & SREG_S));
+    if (m->flags_written & kept)
+        sync_sreg(m);
+
+    m->flags_written = written;
+    m->flags_opcode = (uint8_t)instruction;
+    m->flags_destination = destination;
+    m->flags_source = source;
+    m->flags_result = result;
+}
+
+#endif // FLAGS_H
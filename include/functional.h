@@ -0,0 +1,32 @@
+#ifndef FUNCTIONAL_H
+#define FUNCTIONAL_H
+
+#include "types.h"
+
+// Functional (ISA-level) engine: executes one instruction per step straight
+// from instruction memory, with no latches, stalls or per-stage bookkeeping.
+// It ends in the same registers, SREG and data memory as the pipeline model.
+
+// Timing of the 3-stage pipeline, used to estimate its cycle count
+#define PIPELINE_FILL_CYCLES 2  // Cycles before the first instruction reaches execute
+#define PIPELINE_DRAIN_CYCLES 1 // Final cycle in which execute finds the pipeline empty
+#define BRANCH_PENALTY_CYCLES 2 // Execute bubbles after a flush (execute_stall = 2)
+
+typedef struct
+{
+    long long retired;        // Instructions executed
+    long long taken_branches; // Taken BEQZ and every BR (each one flushes the pipeline)
+} functional_stats_t;
+
+// Function to execute the instruction at PC and advance PC
+// Returns 0 without executing anything if PC holds no instruction
+int functional_step(machine_t *m, functional_stats_t *stats);
+
+// Function to execute from PC until the end of the program or until
+// max_instructions have retired (0: no limit)
+void functional_run(machine_t *m, long long max_instructions, functional_stats_t *stats);
+
+// Function to estimate the cycles the pipeline model would take for a run
+long long estimate_pipeline_cycles(const functional_stats_t *stats);
+
+#endif // FUNCTIONAL_H
@@ -0,0 +1,22 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FNV1A_INIT 2166136261u
+
+// Function to hash a byte string (32-bit FNV-1a), continuing from hash;
+// start with FNV1A_INIT
+static inline uint32_t fnv1a(uint32_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+#endif // HASH_H
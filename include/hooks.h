@@ -0,0 +1,103 @@
+#ifndef HOOKS_H
+#define HOOKS_H
+
+#include <stdint.h>
+#include "types.h"
+#include "trace.h" // trace_stall_t
+
+// Observer hooks. A tool subscribes a callback to a set of events on one
+// machine; the engines report register and memory writes, SREG changes, PC
+// redirects, stalls, flushes and retirements to every subscriber of that
+// event. m->hooks.active is the union of the subscribed events, so with no
+// subscribers each reporting point is a single test of a zero word.
+//
+// While an instruction executes, write_register and write_data only note
+// the location and its old value in a small dirty journal; once the
+// instruction is done the engine reports each journaled write with its new
+// value, then the SREG change and the PC redirect, then the retirement.
+// The pipeline reports stalls and flushes as they happen.
+
+#define HOOK_MAX_SUBSCRIBERS 8
+#define HOOK_JOURNAL_SIZE 4 // Writes of one instruction (the ISA needs one)
+
+typedef enum
+{
+    HOOK_REGISTER_WRITE, // index: register, old_value/new_value
+    HOOK_MEMORY_WRITE,   // index: data address, old_value/new_value
+    HOOK_SREG_CHANGE,    // old_value/new_value
+    HOOK_PC_REDIRECT,    // old_value: where fetch was heading, new_value: the PC execution continues at
+    HOOK_STALL,          // index: trace_stall_t, new_value: cycles left (pipeline only)
+    HOOK_FLUSH,          // new_value: instructions squashed, index: refetch address (pipeline only)
+    HOOK_RETIRE,         // The instruction has finished executing
+    HOOK_EVENT_TYPES
+} hook_type_t;
+
+#define HOOK_BIT(type) (1u << (type))
+#define HOOK_ALL_EVENTS (HOOK_BIT(HOOK_EVENT_TYPES) - 1)
+#define HOOK_CHANGE_EVENTS (HOOK_BIT(HOOK_REGISTER_WRITE) | HOOK_BIT(HOOK_MEMORY_WRITE) | \
+                            HOOK_BIT(HOOK_SREG_CHANGE) | HOOK_BIT(HOOK_PC_REDIRECT))
+
+typedef struct
+{
+    hook_type_t type;
+    int cycle;                      // Pipeline cycle (m->cycle, which the ISA-level engines do not advance)
+    instruction_word_t pc;          // Address of the instruction (0 for stalls that belong to no instruction)
+    instruction_word_t instruction;
+    uint16_t index;                 // Per type, see hook_type_t
+    int old_value;
+    int new_value;
+} hook_event_t;
+
+// Callback of a subscriber; context is the pointer it subscribed with
+typedef void (*hook_callback_t)(void *context, const machine_t *m, const hook_event_t *event);
+
+typedef struct
+{
+    hook_callback_t callback;
+    void *context;
+    uint32_t events; // HOOK_BIT set of the events it receives
+} hook_subscriber_t;
+
+typedef struct
+{
+    uint8_t type;         // HOOK_REGISTER_WRITE or HOOK_MEMORY_WRITE
+    uint16_t index;       // Register or data address
+    data_word_t old_value;
+} hook_write_t;
+
+typedef struct
+{
+    uint32_t active; // Union of the subscribers' events (0: nobody listens)
+    int count;
+    hook_subscriber_t subscribers[HOOK_MAX_SUBSCRIBERS];
+    int journal_count; // Writes of the executing instruction
+    hook_write_t journal[HOOK_JOURNAL_SIZE];
+} hooks_t;
+
+// Function to subscribe a callback to a HOOK_BIT set of events; returns 0
+// if HOOK_MAX_SUBSCRIBERS are already subscribed
+int hooks_subscribe(machine_t *m, uint32_t events, hook_callback_t callback, void *context);
+
+// Function to remove every subscription of a callback and context
+void hooks_unsubscribe(machine_t *m, hook_callback_t callback, void *context);
+
+// Function to pass an event to its subscribers
+void hooks_emit(machine_t *m, const hook_event_t *event);
+
+// Function to note a register or memory write in the dirty journal
+void hooks_journal(machine_t *m, hook_type_t type, uint16_t index, data_word_t old_value);
+
+// Function to report an instruction that has finished executing: its
+// journaled writes, the SREG change against old_sreg, a redirect if the PC
+// is not expected_pc, and the retirement; empties the journal
+void hooks_retire(machine_t *m, instruction_word_t pc, instruction_word_t instruction, data_word_t old_sreg,
+                  instruction_word_t expected_pc);
+
+// Function to report a pipeline stall cycle
+void hooks_stall(machine_t *m, trace_stall_t kind, int cycles_left, instruction_word_t pc,
+                 instruction_word_t instruction);
+
+// Subscriber that prints the changes an instruction made as stage log lines
+void hooks_log_changes(void *context, const machine_t *m, const hook_event_t *event);
+
+#endif // HOOKS_H
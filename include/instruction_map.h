@@ -3,29 +3,37 @@
 
 #include <stdint.h>
 #include <string.h>
+#include "isa.h"
 
-// Enum for instructions
+// Enum for instructions, one enumerator per line of ISA_OPCODES (isa.h)
 typedef enum
 {
-    ADD = 0,
-    SUB = 1,
-    MUL = 2,
-    MOVI = 3,
-    BEQZ = 4,
-    ANDI = 5,
-    EOR = 6,
-    BR = 7,
-    SAL = 8,
-    SAR = 9,
-    LDR = 10,
-    STR = 11,
+#define ISA_ENUM(name, opcode, format, signed_immediate, flags, operands) name = opcode,
+    ISA_OPCODES(ISA_ENUM)
+#undef ISA_ENUM
     INVALID_INSTRUCTION
 } Opcode;
 
 // Alias
 typedef Opcode Instruction;
 
+// Static properties of one 4-bit opcode, indexed by encoding
+typedef struct
+{
+    const char *mnemonic; // NULL for encodings the ISA does not define
+    uint8_t is_r_format;  // Second field is a register (else an immediate)
+    uint8_t sign_bit;     // 0x20 if the immediate is sign-extended, else 0
+    uint8_t flags;        // SREG bits written (SREG_C ... SREG_Z)
+    uint8_t operands;     // Registers read and written (ISA_READS_R1 ...)
+} isa_info_t;
+
+extern const isa_info_t isa_table[ISA_OPCODE_SLOTS];
+
 // Function to get the enum value from instruction text
 Instruction get_instruction_enum(const char* instruction_text);
 
+// Function to look up a mnemonic of the given length (perfect hash, one
+// key compare); returns INVALID_INSTRUCTION if it is not an opcode
+Instruction lookup_mnemonic(const char *text, size_t length);
+
 #endif // INSTRUCTION_MAP_H
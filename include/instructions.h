@@ -5,24 +5,23 @@
 #include "memory.h"
 #include "pipeline.h"
 #include "queue.h"
+#include "flags.h" // update_flags
 
-extern instruction_word_t PC; 
-extern data_word_t SREG;
+// Function to run a load or store through the D-cache model, stalling the
+// whole pipeline on a miss (in execute, or in MEM in the 5-stage pipeline)
+void access_data_cache(machine_t *m, uint16_t address, int write);
 
-extern queue if_id_queue; // Instruction Fetch to Decode stage
-extern queue id_ex_queue; // Decode to Execute stage
-
-void _ADD();
-void _SUB();
-void _MUL();
-void _MOVI();
-void _BEQZ();
-void _ANDI();
-void _EOR();
-void _BR();
-void _SAL();
-void _SAR();
-void _LDR();
-void _STR();
+void _ADD(machine_t *m, ID_EX *id_ex);
+void _SUB(machine_t *m, ID_EX *id_ex);
+void _MUL(machine_t *m, ID_EX *id_ex);
+void _MOVI(machine_t *m, ID_EX *id_ex);
+void _BEQZ(machine_t *m, ID_EX *id_ex);
+void _ANDI(machine_t *m, ID_EX *id_ex);
+void _EOR(machine_t *m, ID_EX *id_ex);
+void _BR(machine_t *m, ID_EX *id_ex);
+void _SAL(machine_t *m, ID_EX *id_ex);
+void _SAR(machine_t *m, ID_EX *id_ex);
+void _LDR(machine_t *m, ID_EX *id_ex);
+void _STR(machine_t *m, ID_EX *id_ex);
 
 #endif // INSTRUCTIONS_H
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef ISA_H
+#define ISA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Single description of the instruction set. Each opcode is one line:
+//
+//     X(name, opcode, format, signed_immediate, flags, operands)
+//
+// name             mnemonic (also the Opcode enumerator; handler is _<name>)
+// opcode           4-bit encoding
+// format           ISA_R (two registers) or ISA_I (register and immediate)
+// signed_immediate 1 if the 6-bit immediate is sign-extended
+// flags            SREG bits the instruction writes
+// operands         registers it reads and writes (hazard detection)
+//
+// The Opcode enum, the mnemonic hash table (generated at build time by
+// tools/isa_gen.c), decode, dispatch, flag updates, hazard detection and the
+// mnemonic names are all expanded from this list, so a new opcode is one
+// line here plus its handler in instructions.c.
+
+// SREG : 000CVNSZ
+#define SREG_C 0x10
+#define SREG_V 0x08
+#define SREG_N 0x04
+#define SREG_S 0x02
+#define SREG_Z 0x01
+
+#define ISA_R 1
+#define ISA_I 0
+
+#define ISA_READS_R1 0x1
+#define ISA_READS_R2 0x2
+#define ISA_WRITES_R1 0x4
+#define ISA_ALU_RR (ISA_READS_R1 | ISA_READS_R2 | ISA_WRITES_R1)
+#define ISA_ALU_RI (ISA_READS_R1 | ISA_WRITES_R1)
+
+#define ISA_OPCODES(X)                                                                \
+    X(ADD, 0, ISA_R, 0, SREG_C | SREG_V | SREG_N | SREG_S | SREG_Z, ISA_ALU_RR)       \
+    X(SUB, 1, ISA_R, 0, SREG_V | SREG_N | SREG_S | SREG_Z, ISA_ALU_RR)                \
+    X(MUL, 2, ISA_R, 0, SREG_N | SREG_Z, ISA_ALU_RR)                                  \
+    X(MOVI, 3, ISA_I, 1, 0, ISA_WRITES_R1)                                            \
+    X(BEQZ, 4, ISA_I, 1, 0, ISA_READS_R1)                                             \
+    X(ANDI, 5, ISA_I, 1, SREG_N | SREG_Z, ISA_ALU_RI)                                 \
+    X(EOR, 6, ISA_R, 0, SREG_N | SREG_Z, ISA_ALU_RR)                                  \
+    X(BR, 7, ISA_R, 0, 0, ISA_READS_R1 | ISA_READS_R2)                                \
+    X(SAL, 8, ISA_I, 0, SREG_N | SREG_Z, ISA_ALU_RI)                                  \
+    X(SAR, 9, ISA_I, 0, SREG_N | SREG_Z, ISA_ALU_RI)                                  \
+    X(LDR, 10, ISA_I, 0, 0, ISA_WRITES_R1)                                            \
+    X(STR, 11, ISA_I, 0, 0, ISA_READS_R1)
+
+#define ISA_OPCODE_SLOTS 16       // Every 4-bit encoding, defined or not
+#define ISA_MAX_MNEMONIC_LENGTH 7 // Mnemonics pack into a 64-bit hash key
+
+// Shift semantics, shared by every engine. The count is the unsigned 6-bit
+// immediate (0..63) and the value is the 8-bit register. SAL shifts the bits
+// left, so a count of 8 or more gives 0; SAR shifts them right, filling
+// with the sign bit, so a count of 8 or more gives 0 or -1 like a count of 7.
+
+// Function to shift an 8-bit value left (SAL)
+static inline int8_t isa_shift_left(int8_t value, uint8_t count)
+{
+    return count < 8 ? (int8_t)(uint8_t)((unsigned)(uint8_t)value << count) : 0;
+}
+
+// Function to shift an 8-bit value right arithmetically (SAR)
+static inline int8_t isa_shift_right(int8_t value, uint8_t count)
+{
+    unsigned bits = (uint8_t)value;
+    unsigned fill = value < 0 ? 0xFF00u : 0; // Sign bits above the value, shifted in from the left
+    return (int8_t)(uint8_t)((bits | fill) >> (count < 8 ? count : 7));
+}
+
+// Function to pack a mnemonic into its hash key: the characters in the low
+// bytes and the length in the top byte; 0 if it is empty or too long
+static inline uint64_t isa_mnemonic_key(const char *text, size_t length)
+{
+    if (length == 0 || length > ISA_MAX_MNEMONIC_LENGTH)
+        return 0;
+
+    uint64_t key = (uint64_t)length << 56;
+    for (size_t i = 0; i < length; i++)
+        key |= (uint64_t)(uint8_t)text[i] << (8 * i);
+    return key;
+}
+
+// Function to map a hash key to its slot in a table of 1 << bits entries
+static inline uint32_t isa_hash_slot(uint64_t key, uint64_t multiplier, int bits)
+{
+    return (uint32_t)((key * multiplier) >> (64 - bits));
+}
+
+#endif // ISA_H
@@ -0,0 +1,35 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdint.h>
+#include "types.h"
+#include "functional.h"
+#include "machine.h"
+
+// Basic-block translator from the 16-bit ISA to native x86-64 code.
+//
+// The JIT is a functional (ISA-level) engine: it only produces architectural
+// results (registers, SREG, data memory and PC), with no pipeline timing and
+// no per-instruction trace. Blocks end at BEQZ/BR, an undefined word or after
+// JIT_MAX_BLOCK instructions, are cached by start address and are invalidated
+// by write_instruction(). Anything that cannot be translated, or every
+// instruction when native code is unavailable, runs on functional_step().
+
+#define JIT_MAX_BLOCK 64 // Maximum number of instructions per translated block
+
+// Function to set up the machine's block cache and code arena; returns 1 if
+// native translation is available
+int jit_init(machine_t *m);
+
+// Function to release the machine's code arena and drop every cached block
+void jit_shutdown(machine_t *m);
+
+// Function to drop any translated block that covers the given address
+// (does nothing for a machine that has never used the JIT)
+void jit_invalidate(machine_t *m, uint16_t address);
+
+// Function to execute from PC until an undefined instruction is reached or
+// max_instructions have retired (0: no limit), accumulating into stats
+void jit_run(machine_t *m, long long max_instructions, functional_stats_t *stats);
+
+#endif // JIT_H
@@ -0,0 +1,80 @@
+#ifndef LANES_H
+#define LANES_H
+
+#include <stdint.h>
+#include <stdalign.h>
+#include "types.h"
+#include "memory.h"
+#include "machine.h"
+#include "functional.h"
+#include "sim.h"
+
+// Lane-parallel functional engine: runs up to LANE_COUNT copies of one
+// program in lockstep, each lane with its own registers, SREG, data memory
+// and PC. State is stored structure-of-arrays (one row of LANE_COUNT bytes
+// per register or memory byte), so every ALU operation, flag update, load
+// and store handles all lanes at once with 8-bit vector instructions.
+//
+// Lanes that disagree on a BEQZ or BR target diverge. Each step executes the
+// lowest PC among the running lanes, masked to the lanes that are at it,
+// so lanes that skipped ahead wait and reconverge when the others catch up.
+// Every lane ends in the same state functional_run() would produce.
+
+#define LANE_COUNT 64 // Lanes per lane machine: one AVX-512 register of bytes
+#define LANE_DATA_SIZE DEFAULT_DATA_MEMORY_SIZE // Data memory per lane
+
+typedef struct
+{
+    // Structure-of-arrays state: [row][lane]
+    alignas(LANE_COUNT) data_word_t registers[REG_COUNT][LANE_COUNT];
+    alignas(LANE_COUNT) data_word_t data_memory[LANE_DATA_SIZE][LANE_COUNT];
+    alignas(LANE_COUNT) data_word_t SREG[LANE_COUNT];
+    alignas(LANE_COUNT) int8_t running[LANE_COUNT]; // -1 while the lane has instructions left, else 0
+
+    instruction_word_t PC[LANE_COUNT]; // Per-lane PC, valid while diverged
+    instruction_word_t shared_pc;      // PC of every running lane while converged
+    int diverged;                      // Running lanes are at different PCs
+    int lane_count;                    // Lanes in use (1..LANE_COUNT)
+
+    long long retired[LANE_COUNT];        // Instructions executed per lane
+    long long taken_branches[LANE_COUNT]; // Taken BEQZ and BR per lane
+
+    instruction_word_t instr_memory[INSTR_MEMORY_SIZE]; // Program shared by all lanes
+    decoded_instr_t decoded_memory[INSTR_MEMORY_SIZE];
+} lane_machine_t;
+
+// Function to allocate a lane machine with lane_count lanes (1..LANE_COUNT)
+// and cleared state; returns NULL on failure
+lane_machine_t *lanes_create(int lane_count);
+
+// Function to free a lane machine
+void lanes_destroy(lane_machine_t *lm);
+
+// Function to load the program every lane runs and its data initializers
+// into every lane; call after lanes_reset
+void lanes_load_image(lane_machine_t *lm, const sim_image_t *image);
+
+// Function to clear every lane's registers, SREG, data memory, PC and counters
+void lanes_reset(lane_machine_t *lm);
+
+// Functions to set and read one lane's inputs and results
+void lanes_set_register(lane_machine_t *lm, int lane, uint8_t reg_num, data_word_t value);
+data_word_t lanes_get_register(const lane_machine_t *lm, int lane, uint8_t reg_num);
+void lanes_set_data(lane_machine_t *lm, int lane, uint16_t address, data_word_t value);
+data_word_t lanes_get_data(const lane_machine_t *lm, int lane, uint16_t address);
+
+// Function to copy a machine's registers, SREG, data memory and PC into a
+// lane; lanes hold the first LANE_DATA_SIZE bytes of data memory
+void lanes_load_machine(lane_machine_t *lm, int lane, const machine_t *m);
+
+// Function to copy a lane's registers, SREG, data memory and PC into a machine
+void lanes_store_machine(const lane_machine_t *lm, int lane, machine_t *m);
+
+// Function to get one lane's retired instruction and taken branch counts
+void lanes_get_stats(const lane_machine_t *lm, int lane, functional_stats_t *stats);
+
+// Function to run every lane until it reaches the end of the program or has
+// retired max_instructions (0: no limit); returns the number of vector steps
+long long lanes_run(lane_machine_t *lm, long long max_instructions);
+
+#endif // LANES_H
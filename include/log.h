@@ -0,0 +1,56 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdio.h>
+
+// Logging verbosity levels, from quietest to most verbose
+typedef enum
+{
+    LOG_OFF = 0,     // Errors only
+    LOG_SUMMARY = 1, // Program load summary and final machine state
+    LOG_STAGE = 2,   // Per-cycle activity of the fetch, decode and execute stages
+    LOG_DEBUG = 3    // Hazard/forwarding internals and parser details
+} log_level_t;
+
+// Current runtime log level (defaults to LOG_DEBUG, the full trace)
+extern log_level_t log_level;
+
+// Function to parse a level name ("off", "summary", "stage", "debug" or 0-3)
+// Returns 1 on success, 0 if the name is not recognised
+int parse_log_level(const char *name, log_level_t *level);
+
+// Function to get the name of a log level
+const char *get_log_level_name(log_level_t level);
+
+#define LOG_ENABLED(level) (log_level >= (level))
+
+// Per-cycle traces (stage and debug levels) are removed at compile time when
+// SIM_NO_TRACE is defined, so the hot loop does no level checks or formatting
+#ifdef SIM_NO_TRACE
+#define TRACE_ENABLED(level) 0
+#else
+#define TRACE_ENABLED(level) LOG_ENABLED(level)
+#endif
+
+#define log_summary(...)                   \
+    do                                     \
+    {                                      \
+        if (LOG_ENABLED(LOG_SUMMARY))      \
+            printf(__VA_ARGS__);           \
+    } while (0)
+
+#define log_stage(...)                     \
+    do                                     \
+    {                                      \
+        if (TRACE_ENABLED(LOG_STAGE))      \
+            printf(__VA_ARGS__);           \
+    } while (0)
+
+#define log_debug(...)                     \
+    do                                     \
+    {                                      \
+        if (TRACE_ENABLED(LOG_DEBUG))      \
+            printf(__VA_ARGS__);           \
+    } while (0)
+
+#endif // LOG_H
@@ -0,0 +1,72 @@
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "types.h"
+#include "memory.h"
+#include "queue.h"
+#include "counters.h"
+#include "predictor.h"
+#include "scoreboard.h"
+#include "cache.h"
+#include "trace.h"
+#include "hooks.h"
+
+typedef struct jit_state jit_state_t;
+
+// Complete state of one simulated machine. Every engine and stage function
+// takes the machine it works on, so a process can run any number of
+// independent simulations side by side.
+struct machine
+{
+    // Architectural state
+    instruction_word_t PC; // Program Counter (next fetch address)
+    data_word_t SREG;      // Status Register, up to the pending flag operation (flags.h)
+    uint8_t flags_written;     // SREG bits the pending operation writes (0: none pending)
+    uint8_t flags_opcode;      // Pending flag operation ...
+    int8_t flags_destination;  // ... its operands
+    int8_t flags_source;
+    int16_t flags_result;      // ... and its result before wrapping to 8 bits
+    data_word_t register_file[REG_COUNT];
+    uint32_t data_memory_size;                 // Addressable data bytes (memory.h)
+    data_word_t *data_pages[DATA_PAGE_COUNT];  // Data memory page table; untouched pages share a zero page
+    instruction_word_t instr_memory[INSTR_MEMORY_SIZE];
+    decoded_instr_t decoded_memory[INSTR_MEMORY_SIZE]; // Pre-decoded copy of instr_memory
+
+    // Pipeline state
+    queue if_id_queue;  // Instruction Fetch to Decode stage
+    queue id_ex_queue;  // Decode to Execute stage
+    queue ex_mem_queue; // Execute to Memory stage (5-stage pipeline; its entries have executed)
+    queue mem_wb_queue; // Memory to Write Back stage (5-stage pipeline)
+    struct EXEC EX;    // Result of the last executed instruction (forwarding source)
+    int cycle;         // Cycle counter
+    int decode_stall;  // Remaining decode bubble cycles
+    int execute_stall; // Remaining execute bubble cycles
+    int stop;          // Cycles since fetch ran past the end of the program
+    int sys_call;      // 1 while the pipeline is running, 0 once it has drained
+    fault_t fault;                 // First guest fault of the run (FAULT_NONE: none, memory.h)
+    instruction_word_t fault_pc;   // ... the PC when it was raised
+    uint16_t fault_address;        // ... and the address or register it went to
+    int fetch_ready_cycle; // First cycle decode can take the last fetched instruction (I-cache miss)
+    int memory_stall;      // Remaining cycles the whole pipeline waits on a D-cache miss
+    int issue_width;       // Instructions each stage handles per cycle (1: scalar, up to MAX_ISSUE_WIDTH)
+    int stages;            // 3 (IF/ID/EX) or 5 (IF/ID/EX/MEM/WB)
+    scoreboard_t scoreboard; // In-flight destinations and the forwarding bypass
+    predictor_t predictor;   // Branch predictor fetch follows
+    cache_t icache;          // Timing models in front of instruction and data memory
+    cache_t dcache;
+    perf_counters_t counters;
+    trace_t *trace;          // Binary trace the stages write to, NULL unless tracing (not owned)
+    hooks_t hooks;           // Observer subscriptions and the dirty journal (hooks.h)
+
+    jit_state_t *jit; // Translated code cache, NULL unless the JIT is in use
+};
+
+// Function to allocate a machine with cleared memories and a reset pipeline
+machine_t *machine_create(void);
+
+// Function to free a machine and everything it owns
+void machine_destroy(machine_t *m);
+
+#endif // MACHINE_H
@@ -6,25 +6,58 @@
 #include <stdlib.h>
 
 // Memory and Register File Declarations
-#define REG_COUNT 64
-#define DATA_MEMORY_SIZE 2048
+#define REG_COUNT 64 // Fixed by the 6-bit register fields of the ISA
 #define INSTR_MEMORY_SIZE 1024
 
-// Memory arrays
-extern data_word_t register_file[REG_COUNT];
-extern data_word_t data_memory[DATA_MEMORY_SIZE];
-extern instruction_word_t instr_memory[INSTR_MEMORY_SIZE];
+// Data memory size is set per machine at startup (--data-memory=N, a power
+// of two). It is backed by a page table: every page starts out as a shared
+// page of zeros and gets its own storage on the first write, so clearing,
+// dumping, hashing and checkpointing data memory only cost the pages a
+// program has written.
+#define DEFAULT_DATA_MEMORY_SIZE 2048
+#define MAX_DATA_MEMORY_SIZE 65536 // Data addresses are 16 bits
+#define DATA_PAGE_BITS 8
+#define DATA_PAGE_SIZE (1 << DATA_PAGE_BITS) // Also the smallest data memory
+#define DATA_PAGE_MASK (DATA_PAGE_SIZE - 1)
+#define DATA_PAGE_COUNT (MAX_DATA_MEMORY_SIZE / DATA_PAGE_SIZE)
+#define IMAGE_DATA_SIZE DEFAULT_DATA_MEMORY_SIZE // Data initializers a program image can carry
+
+// The memory arrays themselves live in the machine context (machine.h)
+
+// Out-of-bounds accesses are guest faults: the accessor reports the first
+// one, records it in the machine (m->fault) and stops it, then the access
+// does nothing (reads return UNDEFINED_INT16 or 0), so a bad program ends
+// its own run instead of the host process
+typedef enum
+{
+    FAULT_NONE,
+    FAULT_INSTRUCTION_READ,
+    FAULT_INSTRUCTION_WRITE,
+    FAULT_DATA_READ,
+    FAULT_DATA_WRITE,
+    FAULT_REGISTER_READ,
+    FAULT_REGISTER_WRITE
+} fault_t;
 
 // Function declarations
-void init_memory();
-instruction_word_t read_instruction(uint16_t address);
-void write_instruction(uint16_t address, instruction_word_t value);
-data_word_t read_data(uint16_t address);
-void write_data(uint16_t address, data_word_t value);
-data_word_t read_register(uint8_t reg_num);
-void write_register(uint8_t reg_num, data_word_t value);
-void print_instruction_memory(void);
-void print_data_memory(void);
-void print_registers(void);
+void init_memory(machine_t *m);
+void init_instr_memory(machine_t *m);
+void init_data_memory(machine_t *m);
+void init_register_file(machine_t *m);
+void free_data_memory(machine_t *m);
+void set_data_memory_size(machine_t *m, uint32_t size);
+void raise_fault(machine_t *m, fault_t fault, uint16_t address);
+data_word_t *touch_data_page(machine_t *m, uint16_t address);
+int data_page_touched(const machine_t *m, uint32_t page);
+instruction_word_t read_instruction(machine_t *m, uint16_t address);
+void write_instruction(machine_t *m, uint16_t address, instruction_word_t value);
+const decoded_instr_t *read_decoded_instruction(machine_t *m, uint16_t address);
+data_word_t read_data(machine_t *m, uint16_t address);
+void write_data(machine_t *m, uint16_t address, data_word_t value);
+data_word_t read_register(machine_t *m, uint8_t reg_num);
+void write_register(machine_t *m, uint8_t reg_num, data_word_t value);
+void print_instruction_memory(machine_t *m);
+void print_data_memory(machine_t *m);
+void print_registers(machine_t *m);
 
 #endif // MEMORY_H
\ No newline at end of file
@@ -0,0 +1,111 @@
+#ifndef OBJECT_H
+#define OBJECT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "types.h"
+#include "sim.h"
+
+// Assembled programs on disk, so runs skip the text assembler.
+//
+// Object file (host byte order, checked on load):
+//
+//     object_header_t   magic, version, section sizes, checksum
+//     object_data_t     data_count data memory initializers
+//     uint16_t          instr_count instruction words
+//     char              name_size bytes of program name (metadata, no terminator)
+//
+// Archive file: many objects behind an index sorted by name, so a program
+// is found with a binary search and loaded straight out of the mapping.
+//
+//     archive_header_t  magic, version, entry count, index and name offsets
+//     object            one complete object per program, 8-byte aligned
+//     archive_entry_t   entry_count index entries, sorted by name
+//     char              NUL-terminated names
+
+#define OBJECT_MAGIC "SIMPROG" // 8 bytes including the terminator
+#define OBJECT_VERSION 1       // Bump whenever the object layout changes
+#define ARCHIVE_MAGIC "SIMARCH"
+#define ARCHIVE_VERSION 1
+#define OBJECT_BYTE_ORDER 0x01020304u
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;  // OBJECT_BYTE_ORDER as written by the assembling host
+    uint32_t header_size; // sizeof(object_header_t)
+    uint16_t instr_count; // Instruction words
+    uint16_t data_count;  // Data memory initializers
+    uint16_t name_size;   // Bytes of program name
+    uint16_t reserved;
+    uint32_t checksum;    // FNV-1a of everything after the header
+} object_header_t;
+
+typedef struct
+{
+    uint16_t address;
+    int8_t value;
+    uint8_t reserved;
+} object_data_t;
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;   // OBJECT_BYTE_ORDER as written by the packing host
+    uint32_t header_size;  // sizeof(archive_header_t)
+    uint32_t entry_count;
+    uint64_t index_offset; // File offset of the archive_entry_t array
+    uint64_t names_offset; // File offset of the name table
+    uint64_t names_size;
+} archive_header_t;
+
+typedef struct
+{
+    uint64_t offset;      // File offset of the object
+    uint32_t size;        // Object size in bytes
+    uint32_t name_offset; // Offset of the name in the name table
+} archive_entry_t;
+
+typedef struct archive archive_t;
+
+// Function to write an image to an object file; name is stored as metadata
+// Returns 1 on success, 0 on failure (with an error on stderr)
+int object_write(const sim_image_t *image, const char *name, const char *file_path);
+
+// Function to decode an object held in memory into an image; returns the
+// number of instructions (0 on failure, with an error naming source on stderr)
+uint16_t object_read(sim_image_t *image, const void *data, size_t size, const char *source);
+
+// Function to check whether a file starts with the object magic
+int object_is_file(const char *file_path);
+
+// Function to map an object file and decode it into an image; returns the
+// number of instructions (0 on failure)
+uint16_t object_load_file(sim_image_t *image, const char *file_path);
+
+// Function to pack programs into an archive. Object files are stored under
+// their path; text files go through the bulk assembler (assembler.h), each
+// program under its .program name or, without one, the file's path
+// Returns 1 on success, 0 if any program failed (errors on stderr)
+int archive_create(const char *file_path, const char *const *programs, int count);
+
+// Function to map an archive and check its index; returns NULL on failure
+archive_t *archive_open(const char *file_path);
+
+// Function to unmap and free an archive
+void archive_close(archive_t *archive);
+
+// Functions to list the programs in an archive (sorted by name)
+int archive_count(const archive_t *archive);
+const char *archive_name(const archive_t *archive, int index);
+
+// Function to find a program by name; returns its index or -1
+int archive_find(const archive_t *archive, const char *name);
+
+// Function to decode one program of an archive into an image; returns the
+// number of instructions (0 on failure)
+uint16_t archive_load(const archive_t *archive, int index, sim_image_t *image);
+
+#endif // OBJECT_H
@@ -1,7 +1,7 @@
 #ifndef PARSER_H
 #define PARSER_H
 
-#include "globals.h"
+#include "machine.h"
 #include <stdint.h>
 #include <string.h>
 #include "memory.h" 
@@ -36,6 +36,6 @@ void print_instruction(const InstructionParser *instr);
  * @param instructions the array of instructions to free
  */
 void free_instructions(InstructionParser *instructions);
-uint16_t parse_and_load_assembly_file(const char *file_path);
+uint16_t parse_and_load_assembly_file(machine_t *m, const char *file_path);
 
 #endif /* PARSER_H */
\ No newline at end of file
@@ -5,14 +5,37 @@
 #include "instructions.h"
 #include "decoder.h"
 #include "types.h"
+#include "machine.h"
 
-void pipeline_cycle();
-extern int sys_call;
-extern int decode_stall;
-extern int execute_stall;
-extern int data_hazard;
-extern int data_stall;
-extern int stop;
-extern struct EXEC EX; // This is now the only declaration of EX as a variable
+// Function to put the pipeline back into its power-on state
+void reset_pipeline(machine_t *m);
+
+// Function to advance the pipeline by one clock cycle
+void pipeline_cycle(machine_t *m);
+
+// Function to skip the idle cycles ahead, or run the cycle if there are none
+// (see pipeline_advance)
+long long pipeline_skip(machine_t *m, long long limit);
+
+// Function to advance the pipeline to its next cycle with work: if no stage
+// has work in the current cycle, jump over every cycle like it in one step
+// (with the same counters and state as running them), otherwise run the
+// cycle. Never goes past cycle limit (0: no limit). Runs with a stage log,
+// a binary trace or hook subscribers see every cycle, so they always step
+// one at a time. Returns the number of cycles advanced.
+//
+// Only a cycle in which fetch has nothing to do can be idle, so that test
+// is inline and the rest only runs when fetch waits or the program is done
+static inline long long pipeline_advance(machine_t *m, long long limit)
+{
+    if (m->memory_stall == 0 &&
+        (m->if_id_queue.count >= 2 || (m->cycle >= m->fetch_ready_cycle && m->PC < INSTR_MEMORY_SIZE &&
+                                       m->instr_memory[m->PC] != UNDEFINED_INT16)))
+    {
+        pipeline_cycle(m);
+        return 1;
+    }
+    return pipeline_skip(m, limit);
+}
 
 #endif // PIPELINE_H
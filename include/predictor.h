@@ -0,0 +1,69 @@
+#ifndef PREDICTOR_H
+#define PREDICTOR_H
+
+#include <stdint.h>
+#include "types.h"
+
+// Branch prediction for the pipeline's fetch stage. Fetch asks the predictor
+// for the next PC after every instruction and follows it; execute resolves
+// BEQZ and BR, trains the predictor and flushes only when fetch went the
+// wrong way.
+//
+// not-taken       Always fetch the next instruction (the original timing:
+//                 every taken branch flushes)
+// backward-taken  Predict BEQZ taken when it jumps backwards (loops)
+// 2bit            A table of 2-bit saturating counters indexed by PC
+//
+// BEQZ targets are PC-relative, so fetch takes them from the pre-decoded
+// instruction. BR jumps to a register pair, so it is only predicted through
+// the branch target buffer (BTB), which works with any of the above.
+
+typedef enum
+{
+    PREDICT_NOT_TAKEN,
+    PREDICT_BACKWARD_TAKEN,
+    PREDICT_TWO_BIT
+} predictor_kind_t;
+
+#define PREDICTOR_MAX_COUNTERS 1024    // Largest 2-bit counter table
+#define PREDICTOR_MAX_BTB 256          // Largest BTB
+#define PREDICTOR_DEFAULT_COUNTERS 256
+#define PREDICTOR_WEAKLY_TAKEN 2       // Counters at or above this predict taken
+
+typedef struct
+{
+    uint16_t pc;     // Address of the BR
+    uint16_t target; // Where it jumped last time
+    uint8_t valid;
+    uint8_t reserved;
+} btb_entry_t;
+
+typedef struct
+{
+    predictor_kind_t kind;
+    uint16_t counter_entries; // Power of two, at most PREDICTOR_MAX_COUNTERS
+    uint16_t btb_entries;     // Power of two, at most PREDICTOR_MAX_BTB (0: no BTB)
+    uint8_t counters[PREDICTOR_MAX_COUNTERS];
+    btb_entry_t btb[PREDICTOR_MAX_BTB];
+} predictor_t;
+
+// Function to configure a predictor and clear its tables
+void predictor_init(predictor_t *predictor, predictor_kind_t kind, int counter_entries, int btb_entries);
+
+// Function to clear the tables, keeping the configuration
+void predictor_reset(predictor_t *predictor);
+
+// Function to predict the instruction fetched after the one at pc; returns
+// 1 and sets *target if the branch is predicted taken, 0 otherwise
+int predict_branch(const predictor_t *predictor, uint16_t pc, const decoded_instr_t *uop, uint16_t *target);
+
+// Function to train the predictor with a resolved branch
+void predictor_update(predictor_t *predictor, uint16_t pc, Opcode opcode, int taken, uint16_t target);
+
+// Function to parse a predictor name; returns 1 if it is known
+int parse_predictor(const char *name, predictor_kind_t *kind);
+
+// Function to get the name of a predictor
+const char *get_predictor_name(predictor_kind_t kind);
+
+#endif // PREDICTOR_H
@@ -2,24 +2,41 @@
 #ifndef QUEUE_H
 #define QUEUE_H
 #include <stdbool.h>
+#include <stdalign.h>
 #include "types.h"
 
+// Pipeline latches are fixed-capacity ring buffers. Each stage moves up to
+// the issue width of instructions per cycle and fetch keeps at most twice
+// that in IF/ID, so neither latch ever holds more than 2 * MAX_ISSUE_WIDTH
+// entries. Must be a power of two.
+#define MAX_ISSUE_WIDTH 4
+#define QUEUE_CAPACITY (2 * MAX_ISSUE_WIDTH)
+#define QUEUE_MASK (QUEUE_CAPACITY - 1)
+#define CACHE_LINE_SIZE 64
+
 typedef struct queue
 {
-    void *front;
-    void *rear;
+    // Slot storage, used as IF/ID or ID/EX entries depending on the latch
+    alignas(CACHE_LINE_SIZE) union
+    {
+        IF_ID if_id[QUEUE_CAPACITY];
+        ID_EX id_ex[QUEUE_CAPACITY];
+    } slots;
+    uint32_t head;  // Index of the oldest entry
+    uint32_t count; // Number of valid entries
 } queue;
 
-queue *createQueue();
+void init_queue(queue *q);
 void enqueue_if_id(queue *q, IF_ID *if_id);
 void enqueue_id_ex(queue *q, ID_EX *id_ex);
 IF_ID *dequeue_if_id(queue *q);
 ID_EX *dequeue_id_ex(queue *q);
 IF_ID *peek_if_id(queue *q);
 ID_EX *peek_id_ex(queue *q);
+void flush_queue(queue *q);
 int isEmpty(queue *q);
 int getQueueSize_if_id(queue *q);
 int getQueueSize_id_ex(queue *q);
 void print_queue(queue *q);
 
-#endif // QUEUE_H
\ No newline at end of file
+#endif // QUEUE_H
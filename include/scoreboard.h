@@ -0,0 +1,179 @@
+#ifndef SCOREBOARD_H
+#define SCOREBOARD_H
+
+#include <stdint.h>
+#include "types.h"
+#include "memory.h"
+#include "queue.h"
+#include "instruction_map.h"
+#include "counters.h"
+#include "log.h"
+
+// Scoreboard and forwarding network of the pipeline. When decode issues an
+// instruction it records, for the register the instruction writes, the
+// cycle from which execute can take the result off the bypass and the cycle
+// at whose end the register file holds it. A source operand whose newest
+// value was not yet in the register file when decode read it is forwarded
+// if the bypass has it by the time the consumer executes; otherwise decode
+// stalls until it does. Which registers an opcode reads and writes comes
+// from the ISA table (isa.h).
+//
+// Execute takes forwarded operands off the bypass in one place before the
+// instruction handler runs, so the handlers only ever see final operand
+// values. In the 3-stage pipeline every dependency between cycles can be
+// forwarded; the counters record the stall cycles that forwarding avoided.
+// Within a superscalar issue group the result is not there yet, so a
+// dependent instruction reports a stall and decode ends the group at it.
+//
+// In the 5-stage pipeline (IF/ID/EX/MEM/WB) an ALU result is forwarded from
+// the EX/MEM latch to the next instruction, and anything a cycle older from
+// MEM/WB. A loaded value only exists after MEM, so an instruction right
+// behind its load stalls one cycle (the load-use hazard). WB writes the
+// register file in the first half of its cycle, so decode in the same
+// cycle reads the new value.
+//
+// The per-instruction operations run on every decode and execute, so they
+// are inline here.
+
+// Timing shared by both pipelines, relative to the cycle an instruction is decoded
+#define SCOREBOARD_EXECUTE_DELAY 1 // Cycles from decode to execute
+#define SCOREBOARD_BYPASS_DELAY 1  // Cycles from execute until an ALU result is on the bypass
+
+typedef struct
+{
+    int ready_cycle[REG_COUNT];      // First cycle an execute can take the newest value off the bypass
+    int written_cycle[REG_COUNT];    // Cycle at whose end the register file holds it
+    data_word_t bypass[REG_COUNT];   // Newest value produced for each register
+    uint16_t producer_pc[REG_COUNT]; // Address of the instruction that produces it
+    int load_delay;      // Cycles from execute until a loaded value is on the bypass
+    int writeback_delay; // Cycles from execute until the register file holds a result
+} scoreboard_t;
+
+// Function to set the scoreboard's timing for a 3- or 5-stage pipeline
+void scoreboard_configure(scoreboard_t *scoreboard, int stages);
+
+// Function to clear the scoreboard: every register file entry is current
+void scoreboard_reset(scoreboard_t *scoreboard);
+
+// Function to forget the destinations of the instructions a flush is about
+// to squash: those decoded behind the branch at the head of the ID/EX latch
+void scoreboard_squash(scoreboard_t *scoreboard, const queue *id_ex_latch);
+
+// Function to push back the destinations still in flight when the whole
+// pipeline freezes for delay cycles after the given cycle
+void scoreboard_delay(scoreboard_t *scoreboard, int cycle, int delay);
+
+// Helper function to check one source operand read in decode this cycle;
+// returns the stall cycles it needs and sets *forward if it must come off
+// the bypass (raising *avoided to the stall cycles that saves, and counting
+// it in *late if it comes from MEM/WB rather than EX/MEM)
+static inline int scoreboard_check_operand(const scoreboard_t *scoreboard, uint8_t reg, int cycle, int *forward,
+                                           int *avoided, int *late)
+{
+    if (scoreboard->written_cycle[reg] < cycle)
+        return 0; // The register file was current when decode read it
+
+    int execute_cycle = cycle + SCOREBOARD_EXECUTE_DELAY;
+    if (scoreboard->ready_cycle[reg] > execute_cycle)
+    {
+        int stall = scoreboard->ready_cycle[reg] - execute_cycle;
+        log_debug("R%u is produced by the instruction at PC %d -> stall %d cycle(s)\n", reg,
+                  scoreboard->producer_pc[reg], stall);
+        return stall;
+    }
+
+    // Without the bypass decode would wait for the register file write
+    int saved = scoreboard->written_cycle[reg] + 1 - cycle;
+    log_debug("R%u is produced by the instruction at PC %d -> forward (avoids %d stall cycle(s))\n", reg,
+              scoreboard->producer_pc[reg], saved);
+    *forward = 1;
+    if (saved > *avoided)
+        *avoided = saved;
+
+    // The producer executed writeback_delay cycles before the write
+    int producer_execute_cycle = scoreboard->written_cycle[reg] - scoreboard->writeback_delay;
+    *late += execute_cycle - producer_execute_cycle > 1;
+    return 0;
+}
+
+// Function to check the operands of the instruction decode is issuing this
+// cycle: marks the ones to forward and returns the number of cycles decode
+// must stall first (0: it can issue now)
+static inline int scoreboard_check(const scoreboard_t *scoreboard, perf_counters_t *counters, ID_EX *id_ex,
+                                   int cycle)
+{
+    uint8_t operands = isa_table[id_ex->opcode & 0xF].operands;
+    int r1_forward = 0, r2_forward = 0;
+    int avoided = 0;
+    int late = 0;
+    int stall = 0;
+
+    if (operands & ISA_READS_R1)
+        stall = scoreboard_check_operand(scoreboard, id_ex->r1, cycle, &r1_forward, &avoided, &late);
+    if (operands & ISA_READS_R2)
+    {
+        int r2_stall = scoreboard_check_operand(scoreboard, id_ex->r2, cycle, &r2_forward, &avoided, &late);
+        if (r2_stall > stall)
+            stall = r2_stall;
+    }
+    if (stall > 0)
+        return stall; // Checked again when decode retries
+
+    id_ex->r1_forward = r1_forward;
+    id_ex->r2_forward = r2_forward;
+    id_ex->data_hazard = r1_forward | r2_forward;
+    counters->data_hazards += id_ex->data_hazard;
+    counters->r1_forwards += r1_forward;
+    counters->r2_forwards += r2_forward;
+    counters->ex_mem_forwards += r1_forward + r2_forward - late;
+    counters->mem_wb_forwards += late;
+    counters->avoided_stall_cycles += avoided;
+    return 0;
+}
+
+// Function to record the destination of an instruction decode issued this cycle
+static inline void scoreboard_issue(scoreboard_t *scoreboard, const ID_EX *id_ex, int cycle)
+{
+    if (!(isa_table[id_ex->opcode & 0xF].operands & ISA_WRITES_R1))
+        return;
+
+    int execute_cycle = cycle + SCOREBOARD_EXECUTE_DELAY;
+    scoreboard->written_cycle[id_ex->r1] = execute_cycle + scoreboard->writeback_delay;
+    scoreboard->ready_cycle[id_ex->r1] =
+        execute_cycle + (id_ex->opcode == LDR ? scoreboard->load_delay : SCOREBOARD_BYPASS_DELAY);
+    scoreboard->producer_pc[id_ex->r1] = id_ex->pc - 1;
+}
+
+// Function to replace an instruction's forwarded operands with the bypass
+// values; called by execute before the handler
+static inline void scoreboard_forward(const scoreboard_t *scoreboard, ID_EX *id_ex)
+{
+    const char *mnemonic = isa_table[id_ex->opcode & 0xF].mnemonic;
+    log_debug("%s: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", mnemonic, id_ex->data_hazard,
+              id_ex->r1_forward, id_ex->r2_forward);
+    if (!id_ex->data_hazard)
+        return;
+
+    if (id_ex->r1_forward)
+    {
+        id_ex->r1_value = scoreboard->bypass[id_ex->r1];
+        log_debug("Data hazard detected in %s instruction. Forwarding R%u: %d...\n", mnemonic, id_ex->r1,
+                  id_ex->r1_value);
+    }
+    if (id_ex->r2_forward)
+    {
+        id_ex->r2_value = scoreboard->bypass[id_ex->r2];
+        log_debug("Data hazard detected in %s instruction. Forwarding R%u: %d...\n", mnemonic, id_ex->r2,
+                  id_ex->r2_value);
+    }
+    id_ex->data_hazard = 0;
+}
+
+// Function to put an executed instruction's result on the bypass
+static inline void scoreboard_writeback(scoreboard_t *scoreboard, const ID_EX *id_ex, data_word_t result)
+{
+    if (isa_table[id_ex->opcode & 0xF].operands & ISA_WRITES_R1)
+        scoreboard->bypass[id_ex->r1] = result;
+}
+
+#endif // SCOREBOARD_H
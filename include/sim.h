@@ -0,0 +1,130 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include "types.h"
+#include "memory.h"
+#include "machine.h"
+#include "functional.h"
+
+// Embedding API of libsim. Each machine_t is an independent simulation, so a
+// harness can create as many as it needs in one process and drive each one
+// through load, step/run, inspect and destroy.
+
+// Execution engines
+typedef enum
+{
+    SIM_ENGINE_PIPELINE,   // Cycle-level 3-stage pipeline model (default)
+    SIM_ENGINE_FUNCTIONAL, // ISA-level interpreter with an estimated cycle count
+    SIM_ENGINE_JIT         // ISA-level x86-64 JIT with an estimated cycle count
+} sim_engine_t;
+
+// Run configuration, shared by the command line and batch manifests
+typedef struct
+{
+    sim_engine_t engine;
+    long long max_cycles; // Cycle limit per run (0: unlimited); instruction limit in ISA-level modes
+    predictor_kind_t predictor; // Pipeline branch predictor (predictor.h)
+    int predictor_entries;      // 2-bit counters in the predictor table
+    int btb_entries;            // Branch target buffer entries (0: no BTB)
+    int data_memory_size;       // Addressable data bytes (memory.h)
+    cache_config_t icache;      // Pipeline cache models (cache.h; size 0: off)
+    cache_config_t dcache;
+    int issue_width;            // Instructions the pipeline fetches, issues and executes per cycle
+    int stages;                 // Pipeline depth: 3 (IF/ID/EX) or 5 (IF/ID/EX/MEM/WB)
+    int cosim;                  // Check the pipeline against the functional engine (cosim.h)
+} sim_config_t;
+
+// Function to fill a configuration with the defaults
+void sim_default_config(sim_config_t *config);
+
+// Function to apply one "--name=value" (or "--cosim") option to a configuration
+// Returns 1 if the option was recognised and valid, 0 otherwise
+int sim_parse_option(sim_config_t *config, const char *option);
+
+// Function to apply a configuration's machine options to a machine: the
+// branch predictor and the caches are replaced with cold ones of the
+// configured kind, the issue width is set, and data memory is cleared if
+// its size changes
+void sim_configure(machine_t *m, const sim_config_t *config);
+
+// Function to create a machine with cleared memories; returns NULL on failure
+machine_t *sim_create(void);
+
+// Function to destroy a machine created by sim_create
+void sim_destroy(machine_t *m);
+
+// Function to assemble a program file into instruction memory; returns the
+// number of instructions loaded (0 on failure, reported on stderr)
+uint16_t sim_load_file(machine_t *m, const char *file_path);
+
+// Function to copy already assembled instruction words into instruction
+// memory starting at address 0; returns the number of words loaded
+uint16_t sim_load_program(machine_t *m, const instruction_word_t *words, uint16_t count);
+
+// Assembled program that can be loaded into many machines without parsing
+// the source again
+typedef struct
+{
+    instruction_word_t words[INSTR_MEMORY_SIZE];
+    decoded_instr_t decoded[INSTR_MEMORY_SIZE]; // Pre-decoded copy of words
+    uint16_t count;                             // Number of instructions in the program
+    uint16_t data_count;                        // Nonzero bytes in data (0: data memory starts cleared)
+    data_word_t data[IMAGE_DATA_SIZE];          // Initial data memory
+} sim_image_t;
+
+// Function to build an image from a program file: assembly text, or an
+// object file written by object_write (object.h); returns the number of
+// instructions loaded (0 on failure)
+uint16_t sim_build_image(sim_image_t *image, const char *file_path);
+
+// Function to fill an image with already assembled instruction words
+// (pre-decoded, no data initializers)
+void sim_image_from_words(sim_image_t *image, const instruction_word_t *words, uint16_t count);
+
+// Function to replace the machine's instruction memory with an image and
+// apply its data initializers; call after sim_reset
+void sim_load_image(machine_t *m, const sim_image_t *image);
+
+// Function to apply only an image's data initializers, e.g. after sim_reset
+// when the program itself is already loaded
+void sim_load_image_data(machine_t *m, const sim_image_t *image);
+
+// Function to clear registers, SREG and data memory and reset the pipeline,
+// keeping the loaded program
+void sim_reset(machine_t *m);
+
+// Machine states sim_step and sim_is_running return. A guest fault (an
+// out-of-bounds access, memory.h) stops the machine for good until the next
+// sim_reset, so step while the state is SIM_RUNNING rather than nonzero.
+#define SIM_FAULTED -1 // Stopped on a guest fault (sim_get_fault)
+#define SIM_STOPPED 0  // The program has drained
+#define SIM_RUNNING 1
+
+// Function to run one pipeline cycle; returns the machine's state after it
+int sim_step(machine_t *m);
+
+// Function to run the pipeline until the program drains, faults or
+// max_cycles is exceeded (0: no limit), storing the number of cycles
+// simulated in *cycles unless it is NULL; returns the fault that stopped
+// the program (FAULT_NONE: none)
+fault_t sim_run(machine_t *m, long long max_cycles, long long *cycles);
+
+// Function to run the functional (ISA-level) engine from PC, accumulating
+// into stats; returns the fault that stopped the program (FAULT_NONE: none)
+fault_t sim_run_functional(machine_t *m, long long max_instructions, functional_stats_t *stats);
+
+// Function to run the JIT engine from PC, accumulating into stats; returns
+// the fault that stopped the program (FAULT_NONE: none)
+fault_t sim_run_jit(machine_t *m, long long max_instructions, functional_stats_t *stats);
+
+// Functions to inspect the machine state
+data_word_t sim_get_register(machine_t *m, uint8_t index);
+data_word_t sim_get_data(machine_t *m, uint16_t address);
+data_word_t sim_get_sreg(const machine_t *m);
+instruction_word_t sim_get_pc(const machine_t *m);
+int sim_get_cycle(const machine_t *m);
+fault_t sim_get_fault(const machine_t *m); // Also see m->fault_pc and m->fault_address
+int sim_is_running(const machine_t *m);    // SIM_RUNNING, SIM_STOPPED or SIM_FAULTED
+
+#endif // SIM_H
@@ -0,0 +1,137 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "queue.h" // CACHE_LINE_SIZE
+
+// Binary pipeline trace. The simulation thread writes fixed-size records
+// into an in-memory ring buffer (a store and a release of the head per
+// event) and a background thread drains it to disk, encoding every field as
+// a zigzag varint of its difference from the previous record, so a trace is
+// a few bytes per event. The trace_text tool (tools/trace_text.c) turns a
+// trace file back into text.
+//
+// File format: TRACE_MAGIC, a byte with TRACE_VERSION, then one encoded
+// record after another up to the end of the file. A record is its type
+// byte, its flags byte and the varints of cycle, pc, instruction, address
+// and value, each minus the same field of the record before (all zero
+// before the first record); the 16-bit fields wrap around.
+
+#define TRACE_MAGIC "SIMTRACE"
+#define TRACE_MAGIC_SIZE 8
+#define TRACE_VERSION 1
+#define TRACE_DEFAULT_RECORDS 65536 // Ring buffer records; a power of two
+#define TRACE_MAX_ENCODED_SIZE (2 + 5 + 4 * 3) // Type, flags, the cycle varint and four 16-bit ones
+
+// Event types; each fills in only the fields listed
+typedef enum
+{
+    TRACE_FETCH,    // pc, instruction; flags: TRACE_PREDICTED_TAKEN (address: next fetch)
+    TRACE_DECODE,   // pc, instruction; flags: TRACE_FORWARD_R1/R2
+    TRACE_EXECUTE,  // pc, instruction: the instruction retires
+    TRACE_REGISTER, // address: register, value: new value
+    TRACE_MEMORY,   // address: data address, value: new value
+    TRACE_FLUSH,    // pc: refetch address, value: instructions squashed
+    TRACE_STALL,    // flags: trace_stall_t (the stage and what it waits for), value: cycles left
+    TRACE_EVENT_TYPES
+} trace_event_t;
+
+// Flags of TRACE_FETCH and TRACE_DECODE
+#define TRACE_PREDICTED_TAKEN 0x01
+#define TRACE_FORWARD_R1 0x01
+#define TRACE_FORWARD_R2 0x02
+
+// What a TRACE_STALL is waiting for
+typedef enum
+{
+    TRACE_STALL_DECODE,       // Decode bubble after a flush
+    TRACE_STALL_EXECUTE,      // Execute bubble after a flush
+    TRACE_STALL_DATA_HAZARD,  // Decode waits for an operand (scoreboard.h)
+    TRACE_STALL_ICACHE,       // Fetch waits on an I-cache miss
+    TRACE_STALL_DCACHE,       // The whole pipeline waits on the D-cache
+    TRACE_STALL_KINDS
+} trace_stall_t;
+
+typedef struct
+{
+    uint32_t cycle;
+    uint8_t type;  // trace_event_t
+    uint8_t flags; // Per type, see trace_event_t
+    uint16_t pc;   // Instruction address (not the PC after it, as in the latches)
+    uint16_t instruction;
+    uint16_t address;
+    int16_t value;
+    uint16_t reserved;
+} trace_record_t;
+
+typedef struct
+{
+    // Written by the simulation thread
+    alignas(CACHE_LINE_SIZE) atomic_ullong head; // Records published so far
+    unsigned long long tail_seen;                // Last tail read, so a full check rarely touches the writer's line
+    trace_record_t *records;
+    unsigned long long mask; // Capacity - 1
+
+    // Written by the writer thread
+    alignas(CACHE_LINE_SIZE) atomic_ullong tail; // Records written out so far
+    atomic_int closing;                          // Set once the last record is published
+    FILE *file;
+    pthread_t thread;
+} trace_t;
+
+// Function to open a trace file and start its writer thread, with a ring
+// buffer of the given number of records (rounded up to a power of two; 0:
+// the default); returns NULL on failure
+trace_t *trace_open(const char *path, int records);
+
+// Function to drain the ring buffer, stop the writer and close the file;
+// returns the number of records written
+long long trace_close(trace_t *trace);
+
+// Function to wait until the writer has made room in a full ring buffer
+void trace_wait(trace_t *trace);
+
+// Function to add one record to the trace
+static inline void trace_event(trace_t *trace, trace_event_t type, uint8_t flags, int cycle, uint16_t pc,
+                               uint16_t instruction, uint16_t address, int16_t value)
+{
+    unsigned long long head = atomic_load_explicit(&trace->head, memory_order_relaxed);
+    if (head - trace->tail_seen > trace->mask)
+        trace_wait(trace);
+
+    trace_record_t *record = &trace->records[head & trace->mask];
+    record->cycle = (uint32_t)cycle;
+    record->type = (uint8_t)type;
+    record->flags = flags;
+    record->pc = pc;
+    record->instruction = instruction;
+    record->address = address;
+    record->value = value;
+    atomic_store_explicit(&trace->head, head + 1, memory_order_release);
+}
+
+// Reader for trace files
+typedef struct
+{
+    FILE *file;
+    trace_record_t previous; // Base of the next record's deltas
+} trace_reader_t;
+
+// Function to open a trace file for reading; returns 1 on success
+int trace_reader_open(trace_reader_t *reader, const char *path);
+
+// Function to read the next record; returns 1 if one was read, 0 at the
+// end of the file and -1 if the file is truncated or corrupt
+int trace_read(trace_reader_t *reader, trace_record_t *record);
+
+// Function to close a trace reader
+void trace_reader_close(trace_reader_t *reader);
+
+// Function to format a record as one line of text (no newline) into buffer
+const char *trace_format(const trace_record_t *record, char *buffer, int size);
+
+#endif // TRACE_H
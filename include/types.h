@@ -10,7 +10,7 @@ typedef uint16_t instruction_word_t; // 16-bit instruction word
 #define UNDEFINED_INT16 32768
 #define UNDEFINED_INT8 128
 
-// Forward declarations for recursive pointers
+typedef struct machine machine_t; // Defined in machine.h
 typedef struct IF_ID IF_ID;
 typedef struct ID_EX ID_EX;
 typedef struct EXEC EXEC; // Changed from EX to EXEC as the type name
@@ -18,7 +18,8 @@ typedef struct EXEC EXEC; // Changed from EX to EXEC as the type name
 struct IF_ID {
     instruction_word_t instr;
     uint16_t pc;
-    IF_ID *next;
+    uint16_t predicted_pc;   // Where fetch went next if it predicted a taken branch
+    uint8_t predicted_taken; // Fetch followed a taken-branch prediction
 };
 
 struct ID_EX {
@@ -28,14 +29,27 @@ struct ID_EX {
     uint8_t r1, r2;
     data_word_t r1_value, r2_value;
     int8_t immediate;
-    ID_EX *next;
     int data_hazard;
     int r1_forward;
     int r2_forward;
+    uint16_t predicted_pc;   // Carried over from IF/ID, checked when a branch resolves
+    uint8_t predicted_taken;
 };
 
+// Pre-decoded instruction: the fields decode extracts from an instruction word,
+// cached per instruction memory address
+typedef struct {
+    Opcode opcode;
+    uint8_t r1, r2;
+    int8_t immediate;
+    uint8_t is_r_format;
+    uint8_t valid; // Cleared when the instruction word is rewritten
+} decoded_instr_t;
+
 struct EXEC {
     data_word_t result; 
+    uint16_t pc;                    // Address after the last executed instruction (as in ID_EX)
+    instruction_word_t instruction; // ... and its word, for co-simulation (cosim.h)
 };
 
 #endif // TYPES_H
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include <string.h>
+#include "assembler.h"
+#include "instruction_map.h"
+#include "log.h"
+
+#define DIRECTIVE_PROGRAM ".program"
+
+static inline int is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline const char *skip_blanks(const char *p, const char *end)
+{
+    while (p < end && is_blank(*p))
+        p++;
+    return p;
+}
+
+// Helper function to parse "R<n>" or a decimal value into a 6-bit field,
+// keeping its low 6 bits as the parser does; returns the position after it,
+// or NULL with error set
+static const char *parse_operand(const char *p, const char *end, uint16_t *field, const char **error)
+{
+    int is_register = p < end && *p == 'R';
+    int negative = 0;
+    if (is_register)
+        p++;
+    else if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    if (p == end || (unsigned)(*p - '0') > 9)
+    {
+        *error = p == end || *p == ',' ? "missing operand" : "expected a register or a number";
+        return NULL;
+    }
+
+    // Only the low 6 bits reach the field, so the digits are summed modulo 64
+    unsigned value = 0;
+    while (p < end && (unsigned)(*p - '0') <= 9)
+    {
+        value = (value * 10 + (unsigned)(*p - '0')) & 0x3F;
+        p++;
+    }
+    if (negative)
+        value = 0u - value;
+
+    *field = (uint16_t)(value & 0x3F);
+    return p;
+}
+
+// Helper function to assemble one instruction line (comment already cut,
+// leading blanks skipped); returns NULL on success or the error message
+static const char *assemble_line(const char *p, const char *end, instruction_word_t *word)
+{
+    const char *mnemonic = p;
+    while (p < end && !is_blank(*p))
+        p++;
+
+    Opcode opcode = lookup_mnemonic(mnemonic, (size_t)(p - mnemonic));
+    if (opcode == INVALID_INSTRUCTION)
+        return "unknown mnemonic";
+
+    // Operands are separated by blanks, a comma or both
+    const char *error = NULL;
+    uint16_t first, second;
+    p = skip_blanks(p, end);
+    p = parse_operand(p, end, &first, &error);
+    if (p == NULL)
+        return error;
+
+    p = skip_blanks(p, end);
+    if (p < end && *p == ',')
+        p = skip_blanks(p + 1, end);
+    p = parse_operand(p, end, &second, &error);
+    if (p == NULL)
+        return error;
+
+    if (skip_blanks(p, end) != end)
+        return "unexpected text after the operands";
+
+    *word = (instruction_word_t)((opcode << 12) | (first << 6) | second);
+    return NULL;
+}
+
+// Function to start scanning a buffer of assembly text
+void asm_init(asm_scanner_t *scanner, const char *text, size_t size)
+{
+    scanner->cursor = text;
+    scanner->end = text + size;
+    scanner->line = 1;
+}
+
+// Function to assemble the next program of the buffer
+asm_status_t asm_next_program(asm_scanner_t *scanner, asm_program_t *program, asm_error_t *error)
+{
+    const char *end = scanner->end;
+    int started = 0; // Seen a directive or an instruction of this program
+    const char *message = NULL;
+
+    program->count = 0;
+    program->name = NULL;
+    program->name_size = 0;
+    program->line = scanner->line;
+
+    while (scanner->cursor < end)
+    {
+        const char *line = scanner->cursor;
+        const char *line_end = memchr(line, '\n', end - line);
+        if (line_end == NULL)
+            line_end = end;
+
+        // Everything after ';' is a comment
+        const char *comment = memchr(line, ';', line_end - line);
+        const char *p = skip_blanks(line, comment ? comment : line_end);
+        const char *text_end = comment ? comment : line_end;
+        while (text_end > p && is_blank(text_end[-1]))
+            text_end--;
+
+        if (p < text_end && *p == '.')
+        {
+            size_t directive = sizeof(DIRECTIVE_PROGRAM) - 1;
+            if (started)
+                break; // The next program starts here; leave the line for the next call
+
+            if ((size_t)(text_end - p) <= directive || memcmp(p, DIRECTIVE_PROGRAM, directive) != 0 ||
+                !is_blank(p[directive]))
+            {
+                if (message == NULL)
+                {
+                    message = "unknown directive";
+                    error->line = scanner->line;
+                }
+            }
+            else
+            {
+                program->name = skip_blanks(p + directive, text_end);
+                program->name_size = (size_t)(text_end - program->name);
+            }
+            program->line = scanner->line;
+            started = 1;
+        }
+        else if (p < text_end)
+        {
+            started = 1;
+            if (message != NULL)
+            {
+                // Skip the rest of a program that already failed
+            }
+            else if (program->count == INSTR_MEMORY_SIZE)
+            {
+                message = "program does not fit in instruction memory";
+                error->line = scanner->line;
+            }
+            else
+            {
+                message = assemble_line(p, text_end, &program->words[program->count]);
+                if (message != NULL)
+                    error->line = scanner->line;
+                else
+                {
+                    log_debug("[PARSER]   Line %d: \"%.*s\" -> HEX: 0x%04X\n", scanner->line, (int)(text_end - p), p,
+                              (uint16_t)program->words[program->count]);
+                    program->count++;
+                }
+            }
+        }
+
+        scanner->cursor = line_end < end ? line_end + 1 : end;
+        scanner->line++;
+    }
+
+    if (message != NULL)
+    {
+        error->message = message;
+        return ASM_ERROR;
+    }
+    if (!started)
+        return ASM_END;
+    if (program->count == 0)
+    {
+        error->line = program->line;
+        error->message = "program has no instructions";
+        return ASM_ERROR;
+    }
+    return ASM_PROGRAM;
+}
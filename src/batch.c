@@ -0,0 +1,547 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "batch.h"
+#include "memory.h"
+#include "functional.h"
+#include "log.h"
+#include "hash.h"
+#include "object.h"
+#include "cosim.h"
+#include "flags.h"
+
+#define MANIFEST_LINE_SIZE 1024
+#define IMAGE_TABLE_MIN_SIZE 64 // Initial size of the program path hash table
+
+// Work-stealing deque over a fixed slice of job indices. Nothing is pushed
+// once the workers start, so the owner only pops from the bottom and thieves
+// only take from the top.
+typedef struct
+{
+    alignas(CACHE_LINE_SIZE) atomic_long top; // Next index thieves take
+    atomic_long bottom;                       // One past the owner's next index
+    const int *jobs;                          // Job numbers owned by this deque
+} job_deque_t;
+
+typedef struct batch batch_t;
+
+typedef struct
+{
+    job_deque_t deque;
+    batch_t *batch;
+    int id;
+    pthread_t thread;
+    long jobs_run; // Jobs executed by this worker
+    long steals;   // Jobs taken from other workers
+} worker_t;
+
+struct batch
+{
+    batch_job_t *jobs;
+    batch_result_t *results;
+    int job_count;
+
+    sim_image_t **images; // One entry per distinct program
+    int image_count;
+
+    worker_t *workers;
+    int worker_count;
+
+    archive_t *archive; // Programs are looked up here instead of on disk, if set
+};
+
+// Function to take the owner's next job; returns -1 when the deque is empty
+static int pop_job(job_deque_t *deque)
+{
+    long bottom = atomic_load(&deque->bottom) - 1;
+    atomic_store(&deque->bottom, bottom);
+    long top = atomic_load(&deque->top);
+
+    if (top > bottom)
+    {
+        atomic_store(&deque->bottom, bottom + 1); // Already empty
+        return -1;
+    }
+
+    int job = deque->jobs[bottom];
+    if (top == bottom)
+    {
+        // Last job: race the thieves for it
+        if (!atomic_compare_exchange_strong(&deque->top, &top, top + 1))
+            job = -1;
+        atomic_store(&deque->bottom, bottom + 1);
+    }
+    return job;
+}
+
+// Function to steal the oldest job of another worker; returns -1 when the
+// deque is empty and -2 when another thread won the race for the job
+static int steal_job(job_deque_t *deque)
+{
+    long top = atomic_load(&deque->top);
+    long bottom = atomic_load(&deque->bottom);
+    if (top >= bottom)
+        return -1;
+
+    int job = deque->jobs[top];
+    if (!atomic_compare_exchange_strong(&deque->top, &top, top + 1))
+        return -2;
+    return job;
+}
+
+// Function to run one job on the worker's machine; *cosim is the worker's
+// co-simulation, created by the first job that asks for one
+static void run_job(machine_t *m, cosim_t **cosim, const batch_t *batch, int index)
+{
+    const batch_job_t *job = &batch->jobs[index];
+    batch_result_t *result = &batch->results[index];
+
+    sim_configure(m, &job->config);
+    sim_reset(m);
+    sim_load_image(m, batch->images[job->image]);
+
+    if (job->config.engine == SIM_ENGINE_PIPELINE && job->config.cosim)
+    {
+        if (*cosim == NULL && (*cosim = cosim_create()) == NULL)
+            exit(EXIT_FAILURE);
+        cosim_start(*cosim, m);
+        result->cycles = cosim_run(*cosim, m, job->config.max_cycles);
+    }
+    else if (job->config.engine == SIM_ENGINE_PIPELINE)
+        sim_run(m, job->config.max_cycles, &result->cycles);
+
+    if (job->config.engine == SIM_ENGINE_PIPELINE)
+    {
+        result->retired = m->counters.retired;
+        result->taken_branches = m->counters.taken_branches;
+        result->branches = m->counters.branches;
+        result->mispredictions = m->counters.flushes;
+        result->status = m->fault != FAULT_NONE ? BATCH_FAULT : sim_is_running(m) == SIM_RUNNING ? BATCH_LIMIT : BATCH_OK;
+        if (job->config.cosim && cosim_diverged(*cosim))
+        {
+            // Keep one job's report together when several threads diverge
+            result->status = BATCH_DIVERGED;
+            flockfile(stderr);
+            fprintf(stderr, "%s (manifest line %d): ", job->program, job->line);
+            cosim_print_divergence(*cosim, m, stderr);
+            funlockfile(stderr);
+        }
+    }
+    else
+    {
+        functional_stats_t stats = {0};
+        if (job->config.engine == SIM_ENGINE_JIT)
+            sim_run_jit(m, job->config.max_cycles, &stats);
+        else
+            sim_run_functional(m, job->config.max_cycles, &stats);
+
+        result->cycles = estimate_pipeline_cycles(&stats);
+        result->retired = stats.retired;
+        result->taken_branches = stats.taken_branches;
+        if (m->fault != FAULT_NONE)
+            result->status = BATCH_FAULT;
+        else
+            result->status = (m->PC < INSTR_MEMORY_SIZE && m->instr_memory[m->PC] != UNDEFINED_INT16)
+                                 ? BATCH_LIMIT
+                                 : BATCH_OK;
+    }
+
+    result->pc = m->PC;
+    result->sreg = read_sreg(m);
+    uint32_t hash = fnv1a(FNV1A_INIT, m->register_file, sizeof(m->register_file));
+    hash = fnv1a(hash, &result->sreg, sizeof(result->sreg));
+
+    // Hash the data pages that hold something, so untouched and cleared
+    // pages hash alike
+    static const data_word_t zeros[DATA_PAGE_SIZE];
+    for (uint32_t page = 0; page < m->data_memory_size / DATA_PAGE_SIZE; page++)
+    {
+        if (!data_page_touched(m, page) || memcmp(m->data_pages[page], zeros, DATA_PAGE_SIZE) == 0)
+            continue;
+        hash = fnv1a(hash, &page, sizeof(page));
+        hash = fnv1a(hash, m->data_pages[page], DATA_PAGE_SIZE);
+    }
+    result->state_hash = hash;
+}
+
+// Worker thread: drain the own deque, then steal until every deque is empty
+static void *worker_main(void *arg)
+{
+    worker_t *self = (worker_t *)arg;
+    batch_t *batch = self->batch;
+
+    machine_t *m = sim_create();
+    if (m == NULL)
+        return NULL; // Other workers steal this worker's jobs; run_batch marks any left over
+    cosim_t *cosim = NULL;
+
+    for (;;)
+    {
+        int job = pop_job(&self->deque);
+        if (job < 0)
+        {
+            // Look for work elsewhere, starting with the next worker
+            int contended = 0;
+            for (int k = 1; k < batch->worker_count && job < 0; k++)
+            {
+                worker_t *victim = &batch->workers[(self->id + k) % batch->worker_count];
+                job = steal_job(&victim->deque);
+                if (job == -2)
+                    contended = 1;
+            }
+            if (job < 0)
+            {
+                if (contended)
+                    continue; // Lost a race; the deque may still hold work
+                break;        // No jobs are added once running, so we are done
+            }
+            self->steals++;
+        }
+
+        if (batch->results[job].status != BATCH_LOAD_ERROR)
+            run_job(m, &cosim, batch, job);
+        self->jobs_run++;
+    }
+
+    cosim_destroy(cosim);
+    sim_destroy(m);
+    return NULL;
+}
+
+// Helper function to find or load the image for a program path
+static int find_image(batch_t *batch, char **paths, int *table, int table_size, const char *program)
+{
+    uint32_t slot = fnv1a(FNV1A_INIT, program, strlen(program)) & (uint32_t)(table_size - 1);
+    while (table[slot] >= 0)
+    {
+        if (strcmp(paths[table[slot]], program) == 0)
+            return table[slot];
+        slot = (slot + 1) & (uint32_t)(table_size - 1);
+    }
+
+    int index = batch->image_count++;
+    table[slot] = index;
+    paths[index] = (char *)program;
+
+    sim_image_t *image = (sim_image_t *)malloc(sizeof(sim_image_t));
+    if (image == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate memory for program image\n");
+        exit(EXIT_FAILURE);
+    }
+
+    uint16_t count = 0;
+    if (batch->archive != NULL)
+    {
+        int member = archive_find(batch->archive, program);
+        if (member >= 0)
+            count = archive_load(batch->archive, member, image);
+    }
+    else
+        count = sim_build_image(image, program);
+    if (count == 0)
+    {
+        free(image);
+        image = NULL;
+    }
+    if (image == NULL)
+        fprintf(stderr, "Error: Could not load program '%s'\n", program);
+    batch->images[index] = image;
+    return index;
+}
+
+// Function to read the manifest into the job list; returns 0 on a syntax error
+static int read_manifest(batch_t *batch, const char *manifest_path)
+{
+    FILE *file = fopen(manifest_path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "Error: Failed to open manifest: %s\n", manifest_path);
+        return 0;
+    }
+
+    int capacity = 0;
+    char line[MANIFEST_LINE_SIZE];
+    int line_number = 0;
+    int ok = 1;
+
+    while (fgets(line, sizeof(line), file))
+    {
+        line_number++;
+        char *token = strtok(line, " \t\r\n");
+        if (token == NULL || token[0] == '#')
+            continue; // Blank line or comment
+
+        if (batch->job_count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            batch->jobs = (batch_job_t *)realloc(batch->jobs, capacity * sizeof(batch_job_t));
+            if (batch->jobs == NULL)
+            {
+                fprintf(stderr, "Error: Failed to allocate memory for batch jobs\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        batch_job_t *job = &batch->jobs[batch->job_count++];
+        job->program = strdup(token);
+        job->line = line_number;
+        job->image = -1;
+        sim_default_config(&job->config);
+
+        while ((token = strtok(NULL, " \t\r\n")) != NULL)
+        {
+            if (!sim_parse_option(&job->config, token))
+            {
+                fprintf(stderr, "Error: %s:%d: Unknown option '%s'\n", manifest_path, line_number, token);
+                ok = 0;
+            }
+        }
+        if (job->config.cosim && job->config.engine != SIM_ENGINE_PIPELINE)
+        {
+            fprintf(stderr, "Error: %s:%d: --cosim needs --mode=pipeline\n", manifest_path, line_number);
+            ok = 0;
+        }
+    }
+
+    fclose(file);
+    return ok;
+}
+
+// Function to free the job list read from the manifest
+static void free_jobs(batch_t *batch)
+{
+    for (int i = 0; i < batch->job_count; i++)
+        free(batch->jobs[i].program);
+    free(batch->jobs);
+}
+
+// Function to load every distinct program once and attach jobs to images
+static void load_images(batch_t *batch)
+{
+    int table_size = IMAGE_TABLE_MIN_SIZE;
+    while (table_size < 2 * batch->job_count)
+        table_size *= 2;
+
+    int *table = (int *)malloc(table_size * sizeof(int));
+    char **paths = (char **)malloc(batch->job_count * sizeof(char *));
+    batch->images = (sim_image_t **)malloc(batch->job_count * sizeof(sim_image_t *));
+    if (table == NULL || paths == NULL || batch->images == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate memory for program images\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < table_size; i++)
+        table[i] = -1;
+
+    for (int i = 0; i < batch->job_count; i++)
+    {
+        batch_job_t *job = &batch->jobs[i];
+        job->image = find_image(batch, paths, table, table_size, job->program);
+        batch->results[i].status = batch->images[job->image] ? BATCH_OK : BATCH_LOAD_ERROR;
+    }
+
+    free(paths);
+    free(table);
+}
+
+// Function to get the name of an engine for the report
+static const char *get_engine_name(sim_engine_t engine)
+{
+    switch (engine)
+    {
+    case SIM_ENGINE_FUNCTIONAL:
+        return "functional";
+    case SIM_ENGINE_JIT:
+        return "jit";
+    default:
+        return "pipeline";
+    }
+}
+
+// Function to get the name of a job status for the report
+static const char *get_status_name(batch_status_t status)
+{
+    switch (status)
+    {
+    case BATCH_OK:
+        return "ok";
+    case BATCH_LIMIT:
+        return "limit";
+    case BATCH_DIVERGED:
+        return "diverged";
+    case BATCH_FAULT:
+        return "fault";
+    case BATCH_SKIPPED:
+        return "skipped";
+    default:
+        return "error";
+    }
+}
+
+// Function to print one line per job followed by the totals
+static void print_report(const batch_t *batch, double seconds)
+{
+    long long total_cycles = 0;
+    long long total_retired = 0;
+    int failed = 0;
+
+    printf("%-5s %-8s %-10s %-14s %12s %12s %8s %6s %5s %-8s %s\n", "Line", "Status", "Mode", "Predictor",
+           "Cycles", "Retired", "Accuracy", "PC", "SREG", "State", "Program");
+    for (int i = 0; i < batch->job_count; i++)
+    {
+        const batch_job_t *job = &batch->jobs[i];
+        const batch_result_t *result = &batch->results[i];
+        if (result->status == BATCH_LOAD_ERROR || result->status == BATCH_SKIPPED)
+        {
+            printf("%-5d %-8s %-10s %-14s %12s %12s %8s %6s %5s %-8s %s\n", job->line, get_status_name(result->status),
+                   get_engine_name(job->config.engine), "-", "-", "-", "-", "-", "-", "-", job->program);
+            failed++;
+            continue;
+        }
+
+        // Prediction only exists in the pipeline model
+        char accuracy[16] = "-";
+        if (job->config.engine == SIM_ENGINE_PIPELINE && result->branches > 0)
+            snprintf(accuracy, sizeof(accuracy), "%.1f%%",
+                     100.0 * (result->branches - result->mispredictions) / result->branches);
+
+        printf("%-5d %-8s %-10s %-14s %12lld %12lld %8s %6d 0x%02X %08X %s\n", job->line,
+               get_status_name(result->status), get_engine_name(job->config.engine),
+               job->config.engine == SIM_ENGINE_PIPELINE ? get_predictor_name(job->config.predictor) : "-",
+               result->cycles, result->retired, accuracy, result->pc, (uint8_t)result->sreg, result->state_hash,
+               job->program);
+
+        if (result->status == BATCH_DIVERGED || result->status == BATCH_FAULT)
+            failed++;
+        total_cycles += result->cycles;
+        total_retired += result->retired;
+    }
+
+    long steals = 0;
+    for (int i = 0; i < batch->worker_count; i++)
+        steals += batch->workers[i].steals;
+
+    printf("\nBatch: %d job(s), %d program image(s), %d failed, %d thread(s), %ld steal(s)\n",
+           batch->job_count, batch->image_count, failed, batch->worker_count, steals);
+    printf("Total: %lld cycles, %lld instructions retired in %.3f s (%.0f jobs/s)\n",
+           total_cycles, total_retired, seconds, seconds > 0 ? batch->job_count / seconds : 0.0);
+}
+
+// Function to run every job in a manifest and print the aggregated report
+int run_batch(const char *manifest_path, const char *archive_path, int threads)
+{
+    batch_t batch = {0};
+    if (!read_manifest(&batch, manifest_path) ||
+        (archive_path != NULL && (batch.archive = archive_open(archive_path)) == NULL))
+    {
+        free_jobs(&batch);
+        return 1;
+    }
+    if (batch.job_count == 0)
+    {
+        fprintf(stderr, "Error: No jobs in manifest: %s\n", manifest_path);
+        free_jobs(&batch);
+        archive_close(batch.archive);
+        return 1;
+    }
+
+    batch.results = (batch_result_t *)calloc(batch.job_count, sizeof(batch_result_t));
+    if (batch.results == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate memory for batch results\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Per-job traces from many threads would interleave, so run quietly
+    log_level_t saved_level = log_level;
+    log_level = LOG_OFF;
+    load_images(&batch);
+
+    if (threads <= 0)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0)
+        threads = 1;
+    if (threads > BATCH_MAX_THREADS)
+        threads = BATCH_MAX_THREADS;
+    if (threads > batch.job_count)
+        threads = batch.job_count;
+
+    // Deal the jobs out in contiguous chunks; stealing evens out the tail
+    int *order = (int *)malloc(batch.job_count * sizeof(int));
+    batch.workers = (worker_t *)aligned_alloc(CACHE_LINE_SIZE, threads * sizeof(worker_t));
+    if (order == NULL || batch.workers == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate memory for batch workers\n");
+        exit(EXIT_FAILURE);
+    }
+    batch.worker_count = threads;
+    for (int i = 0; i < batch.job_count; i++)
+        order[i] = i;
+
+    for (int i = 0; i < threads; i++)
+    {
+        worker_t *worker = &batch.workers[i];
+        long first = (long)batch.job_count * i / threads;
+        long last = (long)batch.job_count * (i + 1) / threads;
+        memset(worker, 0, sizeof(*worker));
+        worker->batch = &batch;
+        worker->id = i;
+        worker->deque.jobs = order + first;
+        atomic_init(&worker->deque.top, 0);
+        atomic_init(&worker->deque.bottom, last - first);
+    }
+
+    struct timespec start_time, end_time;
+    timespec_get(&start_time, TIME_UTC);
+
+    // The calling thread works as worker 0
+    for (int i = 1; i < threads; i++)
+    {
+        if (pthread_create(&batch.workers[i].thread, NULL, worker_main, &batch.workers[i]) != 0)
+        {
+            fprintf(stderr, "Error: Failed to start batch worker %d\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    worker_main(&batch.workers[0]);
+    for (int i = 1; i < threads; i++)
+        pthread_join(batch.workers[i].thread, NULL);
+
+    // Jobs still in a deque were never run: no worker had a machine
+    for (int i = 0; i < threads; i++)
+    {
+        job_deque_t *deque = &batch.workers[i].deque;
+        for (long k = atomic_load(&deque->top); k < atomic_load(&deque->bottom); k++)
+        {
+            if (batch.results[deque->jobs[k]].status != BATCH_LOAD_ERROR)
+                batch.results[deque->jobs[k]].status = BATCH_SKIPPED;
+        }
+    }
+
+    timespec_get(&end_time, TIME_UTC);
+    log_level = saved_level;
+
+    double seconds = (end_time.tv_sec - start_time.tv_sec) +
+                     (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+    print_report(&batch, seconds);
+
+    int failed = 0;
+    for (int i = 0; i < batch.job_count; i++)
+        failed |= batch.results[i].status != BATCH_OK && batch.results[i].status != BATCH_LIMIT;
+
+    archive_close(batch.archive);
+    for (int i = 0; i < batch.image_count; i++)
+        free(batch.images[i]);
+    free(batch.images);
+    free_jobs(&batch);
+    free(batch.results);
+    free(batch.workers);
+    free(order);
+    return failed;
+}
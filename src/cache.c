@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+
+// Helper function to get log2 of a power of two
+static uint8_t log2_of(uint32_t value)
+{
+    uint8_t bits = 0;
+    while ((1u << bits) < value)
+        bits++;
+    return bits;
+}
+
+// Helper function to check for a power of two
+static int is_power_of_two(uint32_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// Function to fill a configuration with the defaults for an enabled cache
+void cache_default_config(cache_config_t *config, uint32_t size)
+{
+    config->size = size;
+    config->line_size = CACHE_DEFAULT_LINE_SIZE;
+    config->ways = 1;
+    config->replacement = CACHE_LRU;
+    config->write_policy = CACHE_WRITE_BACK;
+    config->miss_latency = CACHE_DEFAULT_LATENCY;
+}
+
+// Helper function to parse one numeric field of a cache specification
+static int parse_field(const char *text, size_t length, long minimum, long maximum, long *value)
+{
+    char number[16];
+    if (length == 0 || length >= sizeof(number))
+        return 0;
+    memcpy(number, text, length);
+    number[length] = '\0';
+
+    char *end;
+    *value = strtol(number, &end, 10);
+    return *end == '\0' && *value >= minimum && *value <= maximum;
+}
+
+// Function to parse a cache specification
+int parse_cache_config(const char *spec, cache_config_t *config)
+{
+    cache_config_t parsed;
+    cache_default_config(&parsed, 0);
+    if (strcmp(spec, "off") == 0)
+    {
+        *config = parsed;
+        return 1;
+    }
+
+    while (*spec != '\0')
+    {
+        size_t length = strcspn(spec, ",");
+        const char *value = memchr(spec, '=', length);
+        if (value == NULL)
+            return 0;
+        size_t name_length = (size_t)(value - spec);
+        size_t value_length = length - name_length - 1;
+        value++;
+
+        long number = 0;
+        if (name_length == 4 && strncmp(spec, "size", 4) == 0 &&
+            parse_field(value, value_length, 1, CACHE_MAX_LINES * CACHE_MAX_LINE_SIZE, &number))
+            parsed.size = (uint32_t)number;
+        else if (name_length == 4 && strncmp(spec, "line", 4) == 0 &&
+                 parse_field(value, value_length, 1, CACHE_MAX_LINE_SIZE, &number))
+            parsed.line_size = (uint16_t)number;
+        else if (name_length == 4 && strncmp(spec, "ways", 4) == 0 &&
+                 parse_field(value, value_length, 1, CACHE_MAX_WAYS, &number))
+            parsed.ways = (uint16_t)number;
+        else if (name_length == 7 && strncmp(spec, "latency", 7) == 0 &&
+                 parse_field(value, value_length, 0, CACHE_MAX_LATENCY, &number))
+            parsed.miss_latency = (uint16_t)number;
+        else if (name_length == 7 && strncmp(spec, "replace", 7) == 0 && value_length == 3 &&
+                 strncmp(value, "lru", 3) == 0)
+            parsed.replacement = CACHE_LRU;
+        else if (name_length == 7 && strncmp(spec, "replace", 7) == 0 && value_length == 4 &&
+                 strncmp(value, "plru", 4) == 0)
+            parsed.replacement = CACHE_PLRU;
+        else if (name_length == 5 && strncmp(spec, "write", 5) == 0 && value_length == 4 &&
+                 strncmp(value, "back", 4) == 0)
+            parsed.write_policy = CACHE_WRITE_BACK;
+        else if (name_length == 5 && strncmp(spec, "write", 5) == 0 && value_length == 7 &&
+                 strncmp(value, "through", 7) == 0)
+            parsed.write_policy = CACHE_WRITE_THROUGH;
+        else
+            return 0;
+
+        spec += length;
+        if (*spec == ',')
+            spec++;
+    }
+
+    if (!cache_config_valid(&parsed))
+        return 0;
+    *config = parsed;
+    return 1;
+}
+
+// Function to check a configuration's geometry
+int cache_config_valid(const cache_config_t *config)
+{
+    if (config->size == 0)
+        return 1;
+    if (!is_power_of_two(config->size) || !is_power_of_two(config->line_size) ||
+        !is_power_of_two(config->ways) || config->line_size > CACHE_MAX_LINE_SIZE ||
+        config->ways > CACHE_MAX_WAYS || config->miss_latency > CACHE_MAX_LATENCY ||
+        config->replacement > CACHE_PLRU || config->write_policy > CACHE_WRITE_THROUGH)
+        return 0;
+
+    // At least one set, and no more lines than the model holds
+    uint32_t lines = config->size / config->line_size;
+    return config->size >= (uint32_t)config->line_size * config->ways && lines <= CACHE_MAX_LINES;
+}
+
+// Function to configure a cache and invalidate every line
+void cache_init(cache_t *cache, const cache_config_t *config)
+{
+    cache->config = *config;
+    if (config->size > 0)
+    {
+        cache->sets = config->size / ((uint32_t)config->line_size * config->ways);
+        cache->offset_bits = log2_of(config->line_size);
+        cache->set_bits = log2_of(cache->sets);
+    }
+    else
+    {
+        cache->sets = 0;
+        cache->offset_bits = 0;
+        cache->set_bits = 0;
+    }
+    cache_reset(cache);
+}
+
+// Function to invalidate every line, keeping the configuration
+void cache_reset(cache_t *cache)
+{
+    cache->accesses = 0;
+    memset(cache->lines, 0, sizeof(cache->lines));
+    memset(cache->plru, 0, sizeof(cache->plru));
+}
+
+// Helper function to mark a way as the most recently used of its set
+static void touch(cache_t *cache, uint32_t set, uint32_t way)
+{
+    cache->lines[set * cache->config.ways + way].last_use = cache->accesses;
+    if (cache->config.replacement != CACHE_PLRU)
+        return;
+
+    // Point every node on the way's path at the other half of the tree
+    uint16_t *bits = &cache->plru[set];
+    uint32_t node = 1;
+    for (uint32_t half = cache->config.ways >> 1; half > 0; half >>= 1)
+    {
+        uint32_t right = (way & half) != 0;
+        if (right)
+            *bits &= (uint16_t)~(1u << node);
+        else
+            *bits |= (uint16_t)(1u << node);
+        node = node * 2 + right;
+    }
+}
+
+// Helper function to choose the way a fill replaces
+static uint32_t choose_victim(const cache_t *cache, uint32_t set)
+{
+    const cache_line_t *lines = &cache->lines[set * cache->config.ways];
+    for (uint32_t way = 0; way < cache->config.ways; way++)
+    {
+        if (!lines[way].valid)
+            return way;
+    }
+
+    if (cache->config.replacement == CACHE_PLRU)
+    {
+        // Follow the bits from the root to the pseudo least recently used way
+        uint32_t node = 1;
+        while (node < cache->config.ways)
+            node = node * 2 + ((cache->plru[set] >> node) & 1);
+        return node - cache->config.ways;
+    }
+
+    uint32_t victim = 0;
+    for (uint32_t way = 1; way < cache->config.ways; way++)
+    {
+        if (lines[way].last_use < lines[victim].last_use)
+            victim = way;
+    }
+    return victim;
+}
+
+// Function to look up a byte address, filling the line on a miss
+int cache_access(cache_t *cache, cache_counters_t *counters, uint32_t address, int write)
+{
+    if (cache->config.size == 0)
+        return 0;
+
+    uint32_t block = address >> cache->offset_bits;
+    uint32_t set = block & (cache->sets - 1);
+    uint32_t tag = block >> cache->set_bits;
+    cache_line_t *lines = &cache->lines[set * cache->config.ways];
+    int write_through = write && cache->config.write_policy == CACHE_WRITE_THROUGH;
+    cache->accesses++;
+
+    for (uint32_t way = 0; way < cache->config.ways; way++)
+    {
+        if (lines[way].valid && lines[way].tag == tag)
+        {
+            counters->hits++;
+            touch(cache, set, way);
+            if (write_through)
+            {
+                counters->memory_writes++;
+                return cache->config.miss_latency;
+            }
+            lines[way].dirty |= (uint8_t)write;
+            return 0;
+        }
+    }
+
+    counters->misses++;
+    if (write_through)
+    {
+        counters->memory_writes++; // No write allocate
+        return cache->config.miss_latency;
+    }
+
+    int latency = cache->config.miss_latency;
+    uint32_t way = choose_victim(cache, set);
+    cache_line_t *line = &lines[way];
+    if (line->valid)
+    {
+        counters->evictions++;
+        if (line->dirty)
+        {
+            counters->memory_writes++;
+            latency += cache->config.miss_latency;
+        }
+    }
+    line->valid = 1;
+    line->tag = tag;
+    line->dirty = (uint8_t)write;
+    touch(cache, set, way);
+    return latency;
+}
+
+// Function to describe a cache configuration
+const char *cache_describe(const cache_config_t *config, char *buffer, int size)
+{
+    if (config->size == 0)
+        snprintf(buffer, (size_t)size, "off");
+    else
+        snprintf(buffer, (size_t)size, "%uB, %uB lines, %u-way %s, write-%s, %u-cycle misses", config->size,
+                 config->line_size, config->ways, config->replacement == CACHE_PLRU ? "plru" : "lru",
+                 config->write_policy == CACHE_WRITE_THROUGH ? "through" : "back", config->miss_latency);
+    return buffer;
+}
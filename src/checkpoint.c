@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "checkpoint.h"
+#include "jit.h"
+#include "log.h"
+#include "hash.h"
+#include "file_map.h"
+#include "flags.h"
+#include "instruction_map.h"
+
+// Helper function to save a cache model
+static void save_cache(checkpoint_cache_t *saved, const cache_t *cache)
+{
+    saved->size = cache->config.size;
+    saved->line_size = cache->config.line_size;
+    saved->ways = cache->config.ways;
+    saved->replacement = cache->config.replacement;
+    saved->write_policy = cache->config.write_policy;
+    saved->miss_latency = cache->config.miss_latency;
+    saved->accesses = cache->accesses;
+    memcpy(saved->lines, cache->lines, sizeof(saved->lines));
+    memcpy(saved->plru, cache->plru, sizeof(saved->plru));
+}
+
+// Helper function to get the configuration of a saved cache model
+static cache_config_t saved_cache_config(const checkpoint_cache_t *saved)
+{
+    cache_config_t config = {saved->size, saved->line_size, saved->ways, saved->replacement, saved->write_policy,
+                             saved->miss_latency};
+    return config;
+}
+
+// Helper function to restore a validated cache model
+static void apply_cache(cache_t *cache, const checkpoint_cache_t *saved)
+{
+    cache_config_t config = saved_cache_config(saved);
+    cache_init(cache, &config);
+    cache->accesses = saved->accesses;
+    memcpy(cache->lines, saved->lines, sizeof(cache->lines));
+    memcpy(cache->plru, saved->plru, sizeof(cache->plru));
+}
+
+// Helper function to save a latch of ID_EX entries, oldest first; returns
+// the number saved
+static uint8_t save_id_ex(checkpoint_id_ex_t *saved_entries, const queue *q)
+{
+    for (uint32_t i = 0; i < q->count; i++)
+    {
+        const ID_EX *entry = &q->slots.id_ex[(q->head + i) & QUEUE_MASK];
+        checkpoint_id_ex_t *saved = &saved_entries[i];
+        saved->instruction = entry->instruction;
+        saved->pc = entry->pc;
+        saved->opcode = (uint8_t)entry->opcode;
+        saved->r1 = entry->r1;
+        saved->r2 = entry->r2;
+        saved->r1_value = entry->r1_value;
+        saved->r2_value = entry->r2_value;
+        saved->immediate = entry->immediate;
+        saved->data_hazard = (uint8_t)entry->data_hazard;
+        saved->r1_forward = (uint8_t)entry->r1_forward;
+        saved->r2_forward = (uint8_t)entry->r2_forward;
+        saved->predicted_taken = entry->predicted_taken;
+        saved->predicted_pc = entry->predicted_pc;
+    }
+    return (uint8_t)q->count;
+}
+
+// Helper function to refill a latch of ID_EX entries
+static void apply_id_ex(queue *q, const checkpoint_id_ex_t *saved_entries, int count)
+{
+    init_queue(q);
+    for (int i = 0; i < count; i++)
+    {
+        const checkpoint_id_ex_t *saved = &saved_entries[i];
+        ID_EX entry = {0};
+        entry.instruction = saved->instruction;
+        entry.pc = saved->pc;
+        entry.opcode = (Opcode)saved->opcode;
+        entry.r1 = saved->r1;
+        entry.r2 = saved->r2;
+        entry.r1_value = saved->r1_value;
+        entry.r2_value = saved->r2_value;
+        entry.immediate = saved->immediate;
+        entry.data_hazard = saved->data_hazard;
+        entry.r1_forward = saved->r1_forward;
+        entry.r2_forward = saved->r2_forward;
+        entry.predicted_taken = saved->predicted_taken;
+        entry.predicted_pc = saved->predicted_pc;
+        enqueue_id_ex(q, &entry);
+    }
+}
+
+// Function to write the machine's full state to a checkpoint file
+int checkpoint_save(const machine_t *m, const char *file_path)
+{
+    uint32_t page_count = 0;
+    for (uint32_t page = 0; page < m->data_memory_size / DATA_PAGE_SIZE; page++)
+        page_count += data_page_touched(m, page);
+
+    // The payload and the pages are written, and checksummed, as one block
+    size_t body_size = sizeof(checkpoint_state_t) + page_count * sizeof(checkpoint_page_t);
+    checkpoint_state_t *state = (checkpoint_state_t *)calloc(1, body_size);
+    if (state == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate memory for checkpoint\n");
+        return 0;
+    }
+
+    state->cycle = m->cycle;
+    state->decode_stall = m->decode_stall;
+    state->execute_stall = m->execute_stall;
+    state->stop = m->stop;
+    state->sys_call = m->sys_call;
+    state->fetch_ready_cycle = m->fetch_ready_cycle;
+    state->memory_stall = m->memory_stall;
+    state->pc = m->PC;
+    state->sreg = read_sreg(m);
+    state->ex_result = m->EX.result;
+
+    // Latch entries are stored oldest first, whatever the ring position
+    state->if_id_count = (uint8_t)m->if_id_queue.count;
+    for (uint32_t i = 0; i < m->if_id_queue.count; i++)
+    {
+        const IF_ID *entry = &m->if_id_queue.slots.if_id[(m->if_id_queue.head + i) & QUEUE_MASK];
+        state->if_id[i].instr = entry->instr;
+        state->if_id[i].pc = entry->pc;
+        state->if_id[i].predicted_pc = entry->predicted_pc;
+        state->if_id[i].predicted_taken = entry->predicted_taken;
+    }
+    state->id_ex_count = save_id_ex(state->id_ex, &m->id_ex_queue);
+    state->ex_mem_count = save_id_ex(state->ex_mem, &m->ex_mem_queue);
+    state->mem_wb_count = save_id_ex(state->mem_wb, &m->mem_wb_queue);
+    state->issue_width = (uint8_t)m->issue_width;
+    state->stages = (uint8_t)m->stages;
+
+    memcpy(state->registers, m->register_file, sizeof(state->registers));
+    memcpy(state->instr_memory, m->instr_memory, sizeof(state->instr_memory));
+    for (int i = 0; i < REG_COUNT; i++)
+    {
+        state->ready_cycle[i] = m->scoreboard.ready_cycle[i];
+        state->written_cycle[i] = m->scoreboard.written_cycle[i];
+    }
+    memcpy(state->producer_pc, m->scoreboard.producer_pc, sizeof(state->producer_pc));
+    memcpy(state->bypass, m->scoreboard.bypass, sizeof(state->bypass));
+    state->predictor_kind = (uint8_t)m->predictor.kind;
+    state->predictor_entries = m->predictor.counter_entries;
+    state->btb_entries = m->predictor.btb_entries;
+    memcpy(state->predictor_counters, m->predictor.counters, sizeof(state->predictor_counters));
+    memcpy(state->btb, m->predictor.btb, sizeof(state->btb));
+    save_cache(&state->icache, &m->icache);
+    save_cache(&state->dcache, &m->dcache);
+    _Static_assert(sizeof(state->counters) == sizeof(perf_counters_t), "perf_counters_t must be all 64-bit counters");
+    memcpy(state->counters, &m->counters, sizeof(state->counters));
+
+    checkpoint_page_t *pages = (checkpoint_page_t *)(state + 1);
+    for (uint32_t page = 0, i = 0; page < m->data_memory_size / DATA_PAGE_SIZE; page++)
+    {
+        if (!data_page_touched(m, page))
+            continue;
+        pages[i].page = page;
+        memcpy(pages[i].data, m->data_pages[page], DATA_PAGE_SIZE);
+        i++;
+    }
+
+    checkpoint_header_t header = {0};
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.byte_order = CHECKPOINT_BYTE_ORDER;
+    header.header_size = sizeof(checkpoint_header_t);
+    header.payload_size = sizeof(checkpoint_state_t);
+    header.reg_count = REG_COUNT;
+    header.instr_memory_size = INSTR_MEMORY_SIZE;
+    header.latch_capacity = QUEUE_CAPACITY;
+    header.data_page_size = DATA_PAGE_SIZE;
+    header.data_memory_size = m->data_memory_size;
+    header.data_pages = page_count;
+    header.checksum = fnv1a(FNV1A_INIT, state, body_size);
+
+    FILE *file = fopen(file_path, "wb");
+    int ok = file != NULL &&
+             fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(state, body_size, 1, file) == 1;
+    if (file != NULL && fclose(file) != 0)
+        ok = 0;
+    free(state);
+
+    if (!ok)
+    {
+        fprintf(stderr, "Error: Failed to write checkpoint: %s\n", file_path);
+        return 0;
+    }
+    log_summary("Checkpoint saved at cycle %d: %s\n", m->cycle, file_path);
+    return 1;
+}
+// Helper function to check the entries of a saved ID_EX latch: the register
+// numbers index the register file and the scoreboard after restore, and the
+// opcode indexes execute's dispatch table. An I-format instruction has no R2;
+// the decoder marks it UNDEFINED_INT8.
+static int id_ex_valid(const checkpoint_id_ex_t *saved_entries, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const checkpoint_id_ex_t *saved = &saved_entries[i];
+        if (saved->opcode >= ISA_OPCODE_SLOTS || saved->r1 >= REG_COUNT)
+            return 0;
+        if (saved->r2 >= REG_COUNT && (saved->r2 != UNDEFINED_INT8 || isa_table[saved->opcode].is_r_format))
+            return 0;
+    }
+    return 1;
+}
+
+// Helper function to check a mapped checkpoint and return its payload
+static const checkpoint_state_t *validate(const uint8_t *data, size_t size, const char *file_path)
+{
+    const checkpoint_header_t *header = (const checkpoint_header_t *)data;
+    const char *problem = NULL;
+
+    if (size < sizeof(checkpoint_header_t) || memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0)
+        problem = "not a checkpoint file";
+    else if (header->byte_order != CHECKPOINT_BYTE_ORDER)
+        problem = "saved on a host with a different byte order";
+    else if (header->version != CHECKPOINT_VERSION)
+        problem = "unsupported version";
+    else if (header->header_size != sizeof(checkpoint_header_t) ||
+             header->payload_size != sizeof(checkpoint_state_t) ||
+             header->data_pages > DATA_PAGE_COUNT ||
+             size < sizeof(checkpoint_header_t) + sizeof(checkpoint_state_t) +
+                        header->data_pages * sizeof(checkpoint_page_t))
+        problem = "truncated or wrong size";
+    else if (header->reg_count != REG_COUNT || header->instr_memory_size != INSTR_MEMORY_SIZE ||
+             header->latch_capacity != QUEUE_CAPACITY || header->data_page_size != DATA_PAGE_SIZE)
+        problem = "saved by a build with a different machine geometry";
+    else if (header->data_memory_size < DATA_PAGE_SIZE || header->data_memory_size > MAX_DATA_MEMORY_SIZE ||
+             (header->data_memory_size & (header->data_memory_size - 1)) != 0)
+        problem = "corrupt data memory size";
+
+    const checkpoint_state_t *state = (const checkpoint_state_t *)(data + sizeof(checkpoint_header_t));
+    if (problem == NULL &&
+        header->checksum != fnv1a(FNV1A_INIT, state,
+                                  sizeof(checkpoint_state_t) + header->data_pages * sizeof(checkpoint_page_t)))
+        problem = "checksum mismatch";
+
+    // Pages must be in range and in address order, each stored once
+    const checkpoint_page_t *pages = (const checkpoint_page_t *)(state + 1);
+    for (uint32_t i = 0; problem == NULL && i < header->data_pages; i++)
+    {
+        if (pages[i].page >= header->data_memory_size / DATA_PAGE_SIZE ||
+            (i > 0 && pages[i].page <= pages[i - 1].page))
+            problem = "corrupt data memory pages";
+    }
+    if (problem == NULL && (state->if_id_count > QUEUE_CAPACITY || state->id_ex_count > QUEUE_CAPACITY ||
+                            state->ex_mem_count > QUEUE_CAPACITY || state->mem_wb_count > QUEUE_CAPACITY))
+        problem = "corrupt latch contents";
+    if (problem == NULL && (state->issue_width < 1 || state->issue_width > MAX_ISSUE_WIDTH))
+        problem = "corrupt issue width";
+    if (problem == NULL && (state->stages != 3 && state->stages != 5))
+        problem = "corrupt pipeline depth";
+    if (problem == NULL && state->stages == 3 && (state->ex_mem_count != 0 || state->mem_wb_count != 0))
+        problem = "corrupt latch contents";
+    if (problem == NULL && (!id_ex_valid(state->id_ex, state->id_ex_count) ||
+                            !id_ex_valid(state->ex_mem, state->ex_mem_count) ||
+                            !id_ex_valid(state->mem_wb, state->mem_wb_count)))
+        problem = "corrupt latch contents";
+    if (problem == NULL && (state->predictor_kind > PREDICT_TWO_BIT || state->predictor_entries == 0 ||
+                            state->predictor_entries > PREDICTOR_MAX_COUNTERS ||
+                            (state->predictor_entries & (state->predictor_entries - 1)) != 0 ||
+                            state->btb_entries > PREDICTOR_MAX_BTB ||
+                            (state->btb_entries & (state->btb_entries - 1)) != 0))
+        problem = "corrupt predictor state";
+    if (problem == NULL)
+    {
+        cache_config_t icache = saved_cache_config(&state->icache);
+        cache_config_t dcache = saved_cache_config(&state->dcache);
+        if (!cache_config_valid(&icache) || !cache_config_valid(&dcache))
+            problem = "corrupt cache state";
+    }
+
+    if (problem != NULL)
+    {
+        fprintf(stderr, "Error: Cannot restore checkpoint %s: %s\n", file_path, problem);
+        return NULL;
+    }
+    return state;
+}
+
+// Helper function to copy a validated payload into the machine
+static void apply(machine_t *m, const checkpoint_header_t *header, const checkpoint_state_t *state)
+{
+    m->cycle = (int)state->cycle;
+    m->decode_stall = state->decode_stall;
+    m->execute_stall = state->execute_stall;
+    m->stop = state->stop;
+    m->sys_call = state->sys_call;
+    m->fetch_ready_cycle = state->fetch_ready_cycle;
+    m->memory_stall = state->memory_stall;
+    m->issue_width = state->issue_width;
+    m->stages = state->stages;
+    scoreboard_configure(&m->scoreboard, m->stages);
+    m->PC = state->pc;
+    write_sreg(m, state->sreg);
+    m->EX.result = state->ex_result;
+
+    init_queue(&m->if_id_queue);
+    for (int i = 0; i < state->if_id_count; i++)
+    {
+        IF_ID entry = {state->if_id[i].instr, state->if_id[i].pc, state->if_id[i].predicted_pc,
+                       state->if_id[i].predicted_taken};
+        enqueue_if_id(&m->if_id_queue, &entry);
+    }
+    apply_id_ex(&m->id_ex_queue, state->id_ex, state->id_ex_count);
+    apply_id_ex(&m->ex_mem_queue, state->ex_mem, state->ex_mem_count);
+    apply_id_ex(&m->mem_wb_queue, state->mem_wb, state->mem_wb_count);
+
+    memcpy(m->register_file, state->registers, sizeof(m->register_file));
+    set_data_memory_size(m, header->data_memory_size);
+    const checkpoint_page_t *pages = (const checkpoint_page_t *)(state + 1);
+    for (uint32_t i = 0; i < header->data_pages; i++)
+        memcpy(touch_data_page(m, (uint16_t)(pages[i].page * DATA_PAGE_SIZE)), pages[i].data, DATA_PAGE_SIZE);
+    memcpy(m->instr_memory, state->instr_memory, sizeof(m->instr_memory));
+    memcpy(&m->counters, state->counters, sizeof(m->counters));
+
+    for (int i = 0; i < REG_COUNT; i++)
+    {
+        m->scoreboard.ready_cycle[i] = state->ready_cycle[i];
+        m->scoreboard.written_cycle[i] = state->written_cycle[i];
+    }
+    memcpy(m->scoreboard.producer_pc, state->producer_pc, sizeof(m->scoreboard.producer_pc));
+    memcpy(m->scoreboard.bypass, state->bypass, sizeof(m->scoreboard.bypass));
+
+    m->predictor.kind = (predictor_kind_t)state->predictor_kind;
+    m->predictor.counter_entries = state->predictor_entries;
+    m->predictor.btb_entries = state->btb_entries;
+    memcpy(m->predictor.counters, state->predictor_counters, sizeof(m->predictor.counters));
+    memcpy(m->predictor.btb, state->btb, sizeof(m->predictor.btb));
+    apply_cache(&m->icache, &state->icache);
+    apply_cache(&m->dcache, &state->dcache);
+
+    // Derived state: the pre-decoded copy and any translated code
+    for (int i = 0; i < INSTR_MEMORY_SIZE; i++)
+        m->decoded_memory[i].valid = 0;
+    if (m->jit != NULL)
+        jit_init(m);
+}
+
+// Function to replace the machine's state with a checkpoint file
+int checkpoint_restore(machine_t *m, const char *file_path)
+{
+    size_t size = 0;
+    const uint8_t *data = map_file(file_path, &size);
+    if (data == NULL)
+    {
+        fprintf(stderr, "Error: Failed to open checkpoint: %s\n", file_path);
+        return 0;
+    }
+
+    const checkpoint_state_t *state = validate(data, size, file_path);
+    if (state != NULL)
+        apply(m, (const checkpoint_header_t *)data, state);
+    unmap_file(data, size);
+
+    if (state == NULL)
+        return 0;
+    log_summary("Checkpoint restored at cycle %d: %s\n", m->cycle, file_path);
+    return 1;
+}
@@ -0,0 +1,260 @@
+#include <string.h>
+#include "cosim.h"
+#include "memory.h"
+#include "pipeline.h"
+#include "functional.h"
+#include "decoder.h"
+#include "flags.h"
+
+#define COSIM_MAX_MEMORY_DIFFS 8 // Differing data bytes listed before the rest are counted
+
+// Function to create a co-simulation with an empty reference machine
+cosim_t *cosim_create(void)
+{
+    cosim_t *cosim = (cosim_t *)calloc(1, sizeof(cosim_t));
+    if (cosim == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate memory for the co-simulation\n");
+        return NULL;
+    }
+    cosim->reference = machine_create();
+    if (cosim->reference == NULL)
+    {
+        free(cosim);
+        return NULL;
+    }
+    return cosim;
+}
+
+// Function to free a co-simulation
+void cosim_destroy(cosim_t *cosim)
+{
+    if (cosim == NULL)
+        return;
+    machine_destroy(cosim->reference);
+    free(cosim);
+}
+
+// Helper function to read an instruction word without leaving on a PC past
+// the end of instruction memory
+static instruction_word_t get_instruction(const machine_t *m, instruction_word_t pc)
+{
+    return pc < INSTR_MEMORY_SIZE ? m->instr_memory[pc] : UNDEFINED_INT16;
+}
+
+// Function to copy the pipeline machine's program and architectural state into the reference
+void cosim_start(cosim_t *cosim, machine_t *m)
+{
+    machine_t *reference = cosim->reference;
+    memcpy(reference->instr_memory, m->instr_memory, sizeof(m->instr_memory));
+    memcpy(reference->decoded_memory, m->decoded_memory, sizeof(m->decoded_memory));
+    memcpy(reference->register_file, m->register_file, sizeof(m->register_file));
+    write_sreg(reference, read_sreg(m));
+
+    set_data_memory_size(reference, m->data_memory_size);
+    for (uint32_t page = 0; page < m->data_memory_size / DATA_PAGE_SIZE; page++)
+    {
+        if (data_page_touched(m, page))
+            memcpy(touch_data_page(reference, (uint16_t)(page << DATA_PAGE_BITS)), m->data_pages[page],
+                   DATA_PAGE_SIZE);
+    }
+
+    // Everything still in the latches is yet to execute, so the reference
+    // starts at the oldest of it
+    if (!isEmpty(&m->id_ex_queue))
+        reference->PC = peek_id_ex(&m->id_ex_queue)->pc - 1;
+    else if (!isEmpty(&m->if_id_queue))
+        reference->PC = peek_if_id(&m->if_id_queue)->pc - 1;
+    else
+        reference->PC = m->PC;
+
+    cosim->retired = 0;
+    memset(&cosim->divergence, 0, sizeof(cosim->divergence));
+}
+
+// Helper function to record the first divergence
+static void diverge(cosim_t *cosim, const machine_t *m, int cycle, cosim_status_t status, uint16_t address)
+{
+    cosim_divergence_t *divergence = &cosim->divergence;
+    divergence->status = status;
+    divergence->retirement = cosim->retired;
+    divergence->cycle = cycle;
+    divergence->pc = m->EX.pc - 1;
+    divergence->instruction = m->EX.instruction;
+    divergence->address = address;
+}
+
+// Helper function to step the reference over the instructions the pipeline
+// just retired and compare the state both leave behind. A superscalar
+// pipeline retires a whole group in one cycle, so only the state after the
+// group and the identity of its last instruction can be compared.
+static void check_retirements(cosim_t *cosim, const machine_t *m, int cycle, long long count)
+{
+    machine_t *reference = cosim->reference;
+    uint8_t stored[MAX_ISSUE_WIDTH]; // Addresses the group's stores wrote
+    int stores = 0;
+
+    for (long long i = 0; i < count; i++)
+    {
+        instruction_word_t pc = reference->PC;
+        instruction_word_t instruction = get_instruction(reference, pc);
+        cosim->divergence.reference_pc = pc;
+        cosim->divergence.reference_instruction = instruction;
+
+        if (instruction == UNDEFINED_INT16)
+        {
+            diverge(cosim, m, cycle, COSIM_END, 0);
+            return;
+        }
+        if (i == count - 1 && (pc != m->EX.pc - 1 || instruction != m->EX.instruction))
+        {
+            diverge(cosim, m, cycle, COSIM_INSTRUCTION, 0);
+            return;
+        }
+
+        const decoded_instr_t *uop = read_decoded_instruction(reference, pc);
+        if (uop->opcode == STR && stores < MAX_ISSUE_WIDTH)
+            stored[stores++] = (uint8_t)uop->immediate;
+        functional_stats_t stats = {0};
+        functional_step(reference, &stats);
+    }
+
+    if (memcmp(reference->register_file, m->register_file, sizeof(m->register_file)) != 0 ||
+        read_sreg(reference) != read_sreg(m))
+    {
+        diverge(cosim, m, cycle, COSIM_STATE, 0);
+        return;
+    }
+    for (int i = 0; i < stores; i++)
+    {
+        if (reference->data_pages[0][stored[i]] != m->data_pages[0][stored[i]])
+        {
+            diverge(cosim, m, cycle, COSIM_STATE, stored[i]);
+            return;
+        }
+    }
+    cosim->retired += count;
+}
+
+// Helper function to check the reference once the pipeline has drained:
+// it must be at the end of the program, with the same data memory
+static void check_end(cosim_t *cosim, const machine_t *m, int cycle)
+{
+    machine_t *reference = cosim->reference;
+    cosim->divergence.reference_pc = reference->PC;
+    cosim->divergence.reference_instruction = get_instruction(reference, reference->PC);
+    if (cosim->divergence.reference_instruction != UNDEFINED_INT16)
+    {
+        diverge(cosim, m, cycle, COSIM_END, 0);
+        return;
+    }
+
+    for (uint32_t page = 0; page < m->data_memory_size / DATA_PAGE_SIZE; page++)
+    {
+        if ((!data_page_touched(m, page) && !data_page_touched(reference, page)) ||
+            memcmp(m->data_pages[page], reference->data_pages[page], DATA_PAGE_SIZE) == 0)
+            continue;
+
+        uint32_t offset = 0;
+        while (m->data_pages[page][offset] == reference->data_pages[page][offset])
+            offset++;
+        diverge(cosim, m, cycle, COSIM_MEMORY, (uint16_t)((page << DATA_PAGE_BITS) | offset));
+        return;
+    }
+}
+
+// Function to run the pipeline like sim_run, checking every retirement against the reference
+long long cosim_run(cosim_t *cosim, machine_t *m, long long max_cycles)
+{
+    long long simulated_cycles = 0;
+    while (m->sys_call == 1 && cosim->divergence.status == COSIM_OK)
+    {
+        long long retired = m->counters.retired;
+        int cycle = m->cycle;
+        simulated_cycles += pipeline_advance(m, max_cycles); // Skipped cycles retire nothing
+
+        if (m->counters.retired != retired)
+            check_retirements(cosim, m, cycle, m->counters.retired - retired);
+        if (m->sys_call == 0 && cosim->divergence.status == COSIM_OK)
+            check_end(cosim, m, cycle);
+
+        if (max_cycles > 0 && m->cycle > max_cycles)
+            break;
+    }
+    return simulated_cycles;
+}
+
+// Function to check whether the run has diverged
+int cosim_diverged(const cosim_t *cosim)
+{
+    return cosim->divergence.status != COSIM_OK;
+}
+
+// Helper function to print an instruction line of the report
+static void print_side(FILE *file, const char *side, instruction_word_t pc, instruction_word_t instruction)
+{
+    if (instruction == UNDEFINED_INT16)
+        fprintf(file, "  %-9s PC %d: end of program\n", side, pc);
+    else
+        fprintf(file, "  %-9s PC %d: 0x%04X (%s)\n", side, pc, instruction,
+                get_opcode_mnemonic((uint8_t)(instruction >> 12)));
+}
+
+// Function to print a compact report of the divergence
+void cosim_print_divergence(const cosim_t *cosim, machine_t *m, FILE *file)
+{
+    const cosim_divergence_t *divergence = &cosim->divergence;
+    machine_t *reference = cosim->reference;
+    if (divergence->status == COSIM_OK)
+        return;
+
+    fprintf(file, "Co-simulation diverged after %lld matching retirements, in cycle %d:\n",
+            divergence->retirement, divergence->cycle);
+
+    switch (divergence->status)
+    {
+    case COSIM_INSTRUCTION:
+        print_side(file, "Pipeline", divergence->pc, divergence->instruction);
+        print_side(file, "Reference", divergence->reference_pc, divergence->reference_instruction);
+        break;
+    case COSIM_END:
+        if (m->sys_call == 0)
+            fprintf(file, "  Pipeline  drained\n");
+        else
+            print_side(file, "Pipeline", divergence->pc, divergence->instruction);
+        print_side(file, "Reference", divergence->reference_pc, divergence->reference_instruction);
+        break;
+    case COSIM_STATE:
+        print_side(file, "Retired", divergence->pc, divergence->instruction);
+        for (int i = 0; i < REG_COUNT; i++)
+        {
+            if (m->register_file[i] != reference->register_file[i])
+                fprintf(file, "  R%d: pipeline %d, reference %d\n", i, m->register_file[i],
+                        reference->register_file[i]);
+        }
+        if (read_sreg(m) != read_sreg(reference))
+            fprintf(file, "  SREG: pipeline 0x%02X, reference 0x%02X\n", (uint8_t)read_sreg(m),
+                    (uint8_t)read_sreg(reference));
+        if (m->data_pages[0][divergence->address] != reference->data_pages[0][divergence->address])
+            fprintf(file, "  Data[%d]: pipeline %d, reference %d\n", divergence->address,
+                    m->data_pages[0][divergence->address], reference->data_pages[0][divergence->address]);
+        break;
+    default:
+    {
+        // Data memory: list the first few bytes that differ and count the rest
+        int differences = 0;
+        for (uint32_t address = divergence->address; address < m->data_memory_size; address++)
+        {
+            data_word_t value = read_data(m, (uint16_t)address);
+            data_word_t expected = read_data(reference, (uint16_t)address);
+            if (value == expected)
+                continue;
+            if (differences++ < COSIM_MAX_MEMORY_DIFFS)
+                fprintf(file, "  Data[%u]: pipeline %d, reference %d\n", address, value, expected);
+        }
+        if (differences > COSIM_MAX_MEMORY_DIFFS)
+            fprintf(file, "  ... and %d more differing data bytes\n", differences - COSIM_MAX_MEMORY_DIFFS);
+        break;
+    }
+    }
+}
@@ -0,0 +1,125 @@
+#include "counters.h"
+#include "machine.h"
+#include "decoder.h"
+
+// Function to get the cycles per retired instruction (0 before the first retires)
+static double get_cpi(const perf_counters_t *counters)
+{
+    return counters->retired > 0 ? (double)counters->cycles / counters->retired : 0.0;
+}
+
+// Function to get the instructions retired per cycle
+static double get_ipc(const perf_counters_t *counters)
+{
+    return counters->cycles > 0 ? (double)counters->retired / counters->cycles : 0.0;
+}
+
+// Function to get the fraction of decode's issue slots that issued an instruction
+static double get_slot_utilization(const machine_t *m)
+{
+    long long slots = m->counters.cycles * m->issue_width;
+    return slots > 0 ? (double)m->counters.issued / slots : 0.0;
+}
+
+// Function to get the fraction of branches fetch followed correctly (1 before the first branch)
+static double get_accuracy(const perf_counters_t *counters)
+{
+    return counters->branches > 0 ? 1.0 - (double)counters->flushes / counters->branches : 1.0;
+}
+
+// Function to get a cache's hit rate (1 before the first access)
+static double get_hit_rate(const cache_counters_t *counters)
+{
+    long long accesses = counters->hits + counters->misses;
+    return accesses > 0 ? (double)counters->hits / accesses : 1.0;
+}
+
+// Helper function to write one cache's counters as a JSON member
+static void write_cache_json(FILE *file, const char *name, const cache_t *cache, const cache_counters_t *counters)
+{
+    fprintf(file, "\"%s\":{\"enabled\":%s,\"hits\":%lld,\"misses\":%lld,\"hit_rate\":%.4f,", name,
+            cache->config.size > 0 ? "true" : "false", counters->hits, counters->misses, get_hit_rate(counters));
+    fprintf(file, "\"evictions\":%lld,\"memory_writes\":%lld,\"stall_cycles\":%lld},", counters->evictions,
+            counters->memory_writes, counters->stall_cycles);
+}
+
+// Helper function to print one cache's counters, if the cache is modelled
+static void print_cache(const char *name, const cache_t *cache, const cache_counters_t *counters)
+{
+    if (cache->config.size == 0)
+        return;
+
+    char description[96];
+    printf("%s: %s\n", name, cache_describe(&cache->config, description, sizeof(description)));
+    printf("  Hits: %lld, misses: %lld (hit rate %.1f%%), evictions: %lld, memory writes: %lld, stall cycles: %lld\n",
+           counters->hits, counters->misses, 100.0 * get_hit_rate(counters), counters->evictions,
+           counters->memory_writes, counters->stall_cycles);
+}
+
+// Function to write the machine's counters as one line of JSON
+void counters_write_json(const machine_t *m, FILE *file)
+{
+    const perf_counters_t *c = &m->counters;
+
+    fprintf(file, "{\"cycle\":%d,\"running\":%s,\"cycles\":%lld,\"retired\":%lld,\"cpi\":%.4f,",
+            m->cycle, m->sys_call == 1 ? "true" : "false", c->cycles, c->retired, get_cpi(c));
+    fprintf(file, "\"stages\":%d,\"issue_width\":%d,\"ipc\":%.4f,\"issued\":%lld,\"slot_utilization\":%.4f,",
+            m->stages, m->issue_width, get_ipc(c), c->issued, get_slot_utilization(m));
+    fprintf(file, "\"dependency_splits\":%lld,\"structural_splits\":%lld,", c->dependency_splits,
+            c->structural_splits);
+    fprintf(file, "\"predictor\":\"%s\",\"branches\":%lld,\"taken_branches\":%lld,\"accuracy\":%.4f,",
+            get_predictor_name(m->predictor.kind), c->branches, c->taken_branches, get_accuracy(c));
+    fprintf(file, "\"decode_stall_cycles\":%lld,\"execute_stall_cycles\":%lld,\"flushes\":%lld,\"squashed\":%lld,",
+            c->decode_stall_cycles, c->execute_stall_cycles, c->flushes, c->squashed);
+    fprintf(file, "\"data_hazards\":%lld,\"r1_forwards\":%lld,\"r2_forwards\":%lld,", c->data_hazards,
+            c->r1_forwards, c->r2_forwards);
+    fprintf(file, "\"ex_mem_forwards\":%lld,\"mem_wb_forwards\":%lld,", c->ex_mem_forwards, c->mem_wb_forwards);
+    fprintf(file, "\"avoided_stall_cycles\":%lld,\"data_stall_cycles\":%lld,", c->avoided_stall_cycles,
+            c->data_stall_cycles);
+    write_cache_json(file, "icache", &m->icache, &c->icache);
+    write_cache_json(file, "dcache", &m->dcache, &c->dcache);
+    fprintf(file, "\"loads\":%lld,\"stores\":%lld,\"opcodes\":{", c->opcode_retired[LDR], c->opcode_retired[STR]);
+
+    const char *separator = "";
+    for (int opcode = 0; opcode < ISA_OPCODE_SLOTS; opcode++)
+    {
+        if (isa_table[opcode].mnemonic == NULL)
+            continue;
+        fprintf(file, "%s\"%s\":%lld", separator, isa_table[opcode].mnemonic, c->opcode_retired[opcode]);
+        separator = ",";
+    }
+    fprintf(file, "}}\n");
+}
+
+// Function to print the counters as a human-readable table
+void counters_print(const machine_t *m)
+{
+    const perf_counters_t *c = &m->counters;
+
+    printf("Cycles: %lld, retired: %lld (CPI %.2f, IPC %.2f)\n", c->cycles, c->retired, get_cpi(c), get_ipc(c));
+    printf("Stages: %d, issue width: %d, issued: %lld (slot utilization %.1f%%), groups ended early: "
+           "dependency %lld, structural %lld\n", m->stages, m->issue_width, c->issued,
+           100.0 * get_slot_utilization(m), c->dependency_splits, c->structural_splits);
+    printf("Stall cycles: decode %lld, execute %lld\n", c->decode_stall_cycles, c->execute_stall_cycles);
+    printf("Predictor: %s (%d counters, %d BTB entries)\n", get_predictor_name(m->predictor.kind),
+           m->predictor.counter_entries, m->predictor.btb_entries);
+    printf("Branches: %lld, taken %lld, mispredicted %lld (accuracy %.1f%%)\n",
+           c->branches, c->taken_branches, c->flushes, 100.0 * get_accuracy(c));
+    printf("Branch flushes: %lld, squashed instructions: %lld\n", c->flushes, c->squashed);
+    printf("Data hazards: %lld (R1 forwards %lld, R2 forwards %lld)\n", c->data_hazards, c->r1_forwards,
+           c->r2_forwards);
+    printf("Data stall cycles: %lld, avoided by forwarding: %lld\n", c->data_stall_cycles, c->avoided_stall_cycles);
+    if (m->stages > 3)
+        printf("Forwarded from EX/MEM: %lld, from MEM/WB: %lld (data stalls are load-use stalls)\n",
+               c->ex_mem_forwards, c->mem_wb_forwards);
+    print_cache("I-cache", &m->icache, &c->icache);
+    print_cache("D-cache", &m->dcache, &c->dcache);
+    printf("Loads: %lld, stores: %lld\n", c->opcode_retired[LDR], c->opcode_retired[STR]);
+    printf("Retired per opcode:");
+    for (int opcode = 0; opcode < ISA_OPCODE_SLOTS; opcode++)
+    {
+        if (isa_table[opcode].mnemonic != NULL && c->opcode_retired[opcode] > 0)
+            printf(" %s=%lld", isa_table[opcode].mnemonic, c->opcode_retired[opcode]);
+    }
+    printf("\n");
+}
@@ -1,101 +1,89 @@
 #include <stdio.h>
 #include "decoder.h"
 #include "pipeline.h"
-
-int is_r_format;
+#include "scoreboard.h"
+#include "log.h"
 
 // Function to check if instruction is R-Format
 int isit_r_format(uint8_t opcode)
 {
-    return (opcode == ADD ||
-            opcode == SUB ||
-            opcode == MUL ||
-            opcode == EOR ||
-            opcode == BR);
+    return isa_table[opcode & 0xF].is_r_format;
 }
 
 // Function to check if instruction needs sign extension for immediate
 int needs_sign_extension(uint8_t opcode)
 {
-    // SAL and SAR use positive immediates; others use signed immediates
-    return (opcode == MOVI ||
-            opcode == BEQZ ||
-            opcode == ANDI);
+    return isa_table[opcode & 0xF].sign_bit != 0;
 }
 
-// Function to decode an instruction
-void decode_stage()
+// Function to extract the static fields of an instruction word into a micro-op.
+// Everything format-specific comes from the ISA table, so there are no branches:
+// R-Format: OPCODE (4 bits), R1 (6 bits), R2 (6 bits)
+// I-Format: OPCODE (4 bits), R1 (6 bits), IMMEDIATE (6 bits)
+void predecode_instruction(instruction_word_t instruction, decoded_instr_t *uop)
 {
-    // Make sure queue is not empty before peeking
-    if (isEmpty(&if_id_queue))
-    {
-        printf("Decode Stage: Stopped\n");
-        return;
-    }
+    const isa_info_t *info = &isa_table[(instruction >> 12) & 0xF];
+    uint8_t field = instruction & 0x3F;       // bits 5-0
+    uint8_t r_mask = -info->is_r_format;      // 0xFF for R-Format, else 0
+    uint8_t sign_bit = info->sign_bit;
+
+    uop->opcode = (instruction >> 12) & 0xF;   // bits 15-12
+    uop->is_r_format = info->is_r_format;
+    uop->r1 = (instruction >> 6) & 0x3F;       // bits 11-6
+    uop->r2 = (field & r_mask) | (UNDEFINED_INT8 & ~r_mask);
+    uop->immediate = (int8_t)(((field ^ sign_bit) - sign_bit) & ~r_mask); // Sign-extended for MOVI, BEQZ, ANDI
+    uop->valid = 1;
+}
 
-    IF_ID if_id = *(peek_if_id(&if_id_queue)); // Instruction Fetch to Decode stage
+// Helper function to decode the instruction at the head of IF/ID, the
+// given slot of this cycle's issue group; returns 1 if it was issued
+static int decode_instruction(machine_t *m, int slot)
+{
+    IF_ID if_id = *(peek_if_id(&m->if_id_queue)); // Instruction Fetch to Decode stage
     ID_EX id_ex = {UNDEFINED_INT8};   // Decode to Execute stage
 
     uint16_t instruction = if_id.instr; // Get instruction from IF/ID stage
 
     id_ex.pc = if_id.pc;
     id_ex.instruction = instruction;
+    id_ex.predicted_pc = if_id.predicted_pc;
+    id_ex.predicted_taken = if_id.predicted_taken;
 
     if (if_id.instr != UNDEFINED_INT16)
     {
-        // Extract opcode (bits 15:12)
-        id_ex.opcode = (instruction >> 12) & 0xF;
-
-        // Determine instruction format
-        is_r_format = isit_r_format(id_ex.opcode);
-
+        // Static fields come from the pre-decoded copy of instruction memory,
+        // so only the register reads and hazard checks happen per pass
+        const decoded_instr_t *uop = read_decoded_instruction(m, if_id.pc - 1);
+        id_ex.opcode = uop->opcode;
+        id_ex.r1 = uop->r1;
+        id_ex.r2 = uop->r2;
+        id_ex.immediate = uop->immediate;
+        int is_r_format = uop->is_r_format;
+
+        id_ex.r1_value = read_register(m, id_ex.r1); // Read R1 value
         if (is_r_format)
         {
-            // R-Format: OPCODE (4 bits), R1 (6 bits), R2 (6 bits)
-            id_ex.r1 = (instruction >> 6) & 0x3F; // bits 11-6
-            id_ex.r2 = instruction & 0x3F;        // bits 5-0
-            id_ex.immediate = 0;                  // not used
-
-            id_ex.r1_value = read_register(id_ex.r1); // Read R1 value
-            id_ex.r2_value = read_register(id_ex.r2); // Read R2 value
+            id_ex.r2_value = read_register(m, id_ex.r2); // Read R2 value
         }
-        else
-        {
-            // I-Format: OPCODE (4 bits), R1 (6 bits), IMMEDIATE (6 bits)
-            id_ex.r1 = (instruction >> 6) & 0x3F; // bits 11-6
-            id_ex.r2 = UNDEFINED_INT8;                         // not used
-            // Extract 6-bit immediate
-            uint8_t imm = instruction & 0x3F;         // bits 5-0
-            id_ex.r1_value = read_register(id_ex.r1); // Read R1 value
-
-            // Sign-extend if needed (for MOVI, BEQZ, ANDI, LDR, STR)
-            if (needs_sign_extension(id_ex.opcode))
-            {
-                id_ex.immediate = (imm & 0x20) ? (imm | 0xC0) : imm; // Sign-extend to 8 bits
-            }
-            else
-            {
-                id_ex.immediate = imm; // Positive immediate for SAL, SAR
-            }        
-        } 
+
         // Print decode stage information with input and output values
-        printf("Decode Stage:\n");
-        printf("  Input: Instruction = 0x%04X from PC = %d\n", instruction, id_ex.pc - 1);
-        printf("  Opcode: %u (%s)\n", id_ex.opcode, get_opcode_mnemonic(id_ex.opcode));
-        printf("  Format: %s\n", is_r_format ? "R-Format" : "I-Format");
+        log_stage("Decode Stage:\n");
+        log_stage("  Input: Instruction = 0x%04X from PC = %d\n", instruction, id_ex.pc - 1);
+        log_stage("  Opcode: %u (%s)\n", id_ex.opcode, get_opcode_mnemonic(id_ex.opcode));
+        log_stage("  Format: %s\n", is_r_format ? "R-Format" : "I-Format");
         
         // Print detailed input/output information
-        printf("  Output: ");
+        log_stage("  Output: ");
         if (is_r_format)
         {
-            printf("R1: R%u = %d, R2: R%u = %d, PC: %u\n", 
+            log_stage("R1: R%u = %d, R2: R%u = %d, PC: %u\n", 
                    id_ex.r1, id_ex.r1_value, 
                    id_ex.r2, id_ex.r2_value,
                    id_ex.pc);
         }
         else
         {
-            printf("R1: R%u = %d, Immediate: %d, PC: %u\n", 
+            log_stage("R1: R%u = %d, Immediate: %d, PC: %u\n", 
                    id_ex.r1, id_ex.r1_value, 
                    id_ex.immediate,
                    id_ex.pc);
@@ -104,83 +92,106 @@ void decode_stage()
         // Print the instruction in human-readable format
         print_decoded_instruction(id_ex.opcode, id_ex.r1, id_ex.r2, id_ex.immediate, is_r_format);
 
-        // Dequeue from IF to ID stage (do this after processing the instruction)
-        dequeue_if_id(&if_id_queue);
-        if(!isEmpty(&id_ex_queue)){
-        ID_EX executing = *(peek_id_ex(&id_ex_queue)); // Decode to Execute stage
-        if (executing.opcode!=BEQZ && executing.opcode!=BR){
-            // Check for data hazards
-            if ( id_ex.opcode==LDR && executing.opcode==STR&&id_ex.immediate==executing.immediate){
-                  id_ex.data_hazard = 1;
-                
-            }
-            else if (id_ex.r1==executing.r1 && (id_ex.opcode!=LDR && id_ex.opcode!=MOVI)){
-                 id_ex.data_hazard = 1; 
-                 id_ex.r1_forward=1;  
-            }            else if (id_ex.r2==executing.r1){
-                id_ex.data_hazard = 1;
-                id_ex.r2_forward=1;
-            }
+        // Operands still in flight come off the bypass (scoreboard.h); if
+        // they would not be there in time, the instruction waits in IF/ID
+        int stall = scoreboard_check(&m->scoreboard, &m->counters, &id_ex, m->cycle);
+        if (stall > 0 && slot > 0)
+        {
+            // Only an older instruction of the same group can still be this far out
+            log_stage("Decode Stage: Issue group ends on a dependency, issued next cycle\n");
+            m->counters.dependency_splits++;
+            return 0;
+        }
+        if (stall > 0)
+        {
+            log_stage("Decode Stage: Stalled on a data hazard (%d cycles left)\n", stall);
+            if (m->trace != NULL)
+                trace_event(m->trace, TRACE_STALL, TRACE_STALL_DATA_HAZARD, m->cycle, id_ex.pc - 1, instruction, 0,
+                            (int16_t)stall);
+            if (m->hooks.active & HOOK_BIT(HOOK_STALL))
+                hooks_stall(m, TRACE_STALL_DATA_HAZARD, stall, id_ex.pc - 1, instruction);
+            m->counters.data_stall_cycles++;
+            return 0;
         }
-         printf("immediate: %d  current r1: %d  current r2:%d r1 of execute:%d",id_ex.immediate,id_ex.r1,id_ex.r2,executing.r1);
-       }
-      
+        scoreboard_issue(&m->scoreboard, &id_ex, m->cycle);
+
+        // Dequeue from IF to ID stage (do this after processing the instruction)
+        dequeue_if_id(&m->if_id_queue);
+
         // Print data hazard information
         if (id_ex.data_hazard)
         {
-            printf("Data hazard detected: ");
+            log_debug("Data hazard detected: ");
             if (id_ex.r1_forward)
-                printf("R1 ");
+                log_debug("R1 ");
             if (id_ex.r2_forward)
-                printf("R2 ");
-            printf("\n");
+                log_debug("R2 ");
+            log_debug("\n");
         }
         else
         {
-            printf("No data hazard detected.\n");
+            log_debug("No data hazard detected.\n");
         }
         
         // Print data hazard signal
-       printf("Data hazard signal:%d , forward to %d\n", id_ex.data_hazard,id_ex.r1_forward? 1:id_ex.r2_forward? 2:0);
+       log_debug("Data hazard signal:%d , forward to R1:%d R2:%d\n", id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
         // Enqueue to Decode to Execute stage
-        enqueue_id_ex(&id_ex_queue, &id_ex);
-       
+        enqueue_id_ex(&m->id_ex_queue, &id_ex);
+        if (m->trace != NULL)
+            trace_event(m->trace, TRACE_DECODE,
+                        (id_ex.r1_forward ? TRACE_FORWARD_R1 : 0) | (id_ex.r2_forward ? TRACE_FORWARD_R2 : 0),
+                        m->cycle, id_ex.pc - 1, instruction, 0, 0);
+        m->counters.issued++;
+        return 1;
+    }
+    return 0;
+}
+
+// Function to run decode for one cycle: issues up to the issue width of
+// instructions from IF/ID in program order, ending the group early at an
+// instruction that needs the result of an older one in it, or that would be
+// the group's second memory access or second MUL (one unit of each)
+void decode_stage(machine_t *m)
+{
+    // Make sure queue is not empty before peeking
+    if (isEmpty(&m->if_id_queue))
+    {
+        log_stage("Decode Stage: Stopped\n");
         return;
     }
+
+    int memory_accesses = 0;
+    int multiplies = 0;
+    for (int slot = 0;; slot++)
+    {
+        Opcode opcode = (Opcode)(peek_if_id(&m->if_id_queue)->instr >> 12);
+        int memory_access = opcode == LDR || opcode == STR;
+        if ((memory_access && memory_accesses > 0) || (opcode == MUL && multiplies > 0))
+        {
+            log_stage("Decode Stage: Issue group ends on a second %s, issued next cycle\n",
+                      memory_access ? "memory access" : "MUL");
+            m->counters.structural_splits++;
+            return;
+        }
+
+        if (!decode_instruction(m, slot))
+            return;
+        memory_accesses += memory_access;
+        multiplies += opcode == MUL;
+
+        // The group also ends at its width, or where IF/ID runs out (or its
+        // last entry is still coming from the I-cache)
+        if (slot + 1 >= m->issue_width || isEmpty(&m->if_id_queue) ||
+            (m->if_id_queue.count == 1 && m->cycle < m->fetch_ready_cycle))
+            return;
+    }
 }
 
 // Function to get opcode mnemonic string
 const char *get_opcode_mnemonic(uint8_t opcode)
 {
-    switch (opcode)
-    {
-    case ADD:
-        return "ADD";
-    case SUB:
-        return "SUB";
-    case MUL:
-        return "MUL";
-    case MOVI:
-        return "MOVI";
-    case BEQZ:
-        return "BEQZ";
-    case ANDI:
-        return "ANDI";
-    case EOR:
-        return "EOR";
-    case BR:
-        return "BR";
-    case SAL:
-        return "SAL";
-    case SAR:
-        return "SAR";
-    case LDR:
-        return "LDR";
-    case STR:
-        return "STR";
-    default:
-        return "UNKNOWN";
-    }
+    const char *mnemonic = opcode < ISA_OPCODE_SLOTS ? isa_table[opcode].mnemonic : NULL;
+    return mnemonic != NULL ? mnemonic : "UNKNOWN";
 }
 
 // Function to print decoded instruction in human-readable format
@@ -188,21 +199,21 @@ void print_decoded_instruction(uint8_t opcode, uint8_t r1, uint8_t r2, int8_t im
 {
     const char *mnemonic = get_opcode_mnemonic(opcode);
 
-    printf("  Decoded: %s ", mnemonic);
+    log_stage("  Decoded: %s ", mnemonic);
 
     // All instructions have at least one register
-    printf("R%u", r1);
+    log_stage("R%u", r1);
 
     if (is_r_format)
     {
         // R-format instructions have two registers
-        printf(" R%u", r2);
+        log_stage(" R%u", r2);
     }
     else
     {
         // I-format instructions have an immediate
-        printf(" %d", immediate);
+        log_stage(" %d", immediate);
     }
 
-    printf("\n");
+    log_stage("\n");
 }
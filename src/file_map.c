@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "file_map.h"
+
+#if defined(__unix__)
+#define FILE_MAP_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define FILE_MAP_MMAP 0
+#endif
+
+// Function to map a whole file read-only
+const uint8_t *map_file(const char *file_path, size_t *size)
+{
+#if FILE_MAP_MMAP
+    int fd = open(file_path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+
+    *size = (size_t)info.st_size;
+    void *data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    return data == MAP_FAILED ? NULL : (const uint8_t *)data;
+#else
+    FILE *file = fopen(file_path, "rb");
+    if (!file)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = length > 0 ? (uint8_t *)malloc((size_t)length) : NULL;
+    if (data == NULL || fread(data, 1, (size_t)length, file) != (size_t)length)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = (size_t)length;
+    return data;
+#endif
+}
+
+// Function to release a view returned by map_file
+void unmap_file(const uint8_t *data, size_t size)
+{
+#if FILE_MAP_MMAP
+    munmap((void *)data, size);
+#else
+    (void)size;
+    free((void *)data);
+#endif
+}
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include "functional.h"
+#include "memory.h"
+#include "instructions.h"
+
+// Function to execute the instruction at PC and advance PC
+int functional_step(machine_t *m, functional_stats_t *stats)
+{
+    if (read_instruction(m, m->PC) == UNDEFINED_INT16)
+        return 0; // End of program
+
+    const decoded_instr_t *uop = read_decoded_instruction(m, m->PC);
+    data_word_t destination = read_register(m, uop->r1);
+    data_word_t source = uop->is_r_format ? read_register(m, uop->r2) : 0;
+    int8_t immediate = uop->immediate;
+    instruction_word_t next_pc = m->PC + 1;
+    int16_t result;
+
+    // Observers see the instruction's changes once it is done (hooks.h)
+    data_word_t old_sreg = 0;
+    instruction_word_t pc = m->PC;
+    if (m->hooks.active != 0)
+    {
+        old_sreg = read_sreg(m);
+        m->hooks.journal_count = 0;
+    }
+
+    switch (uop->opcode)
+    {
+    case ADD:
+        result = destination + source;
+        update_flags(m, ADD, destination, source, result);
+        write_register(m, uop->r1, (int8_t)result);
+        break;
+    case SUB:
+        result = destination - source;
+        update_flags(m, SUB, destination, source, result);
+        write_register(m, uop->r1, (int8_t)result);
+        break;
+    case MUL:
+        result = destination * source;
+        update_flags(m, MUL, destination, source, result);
+        write_register(m, uop->r1, (int8_t)result);
+        break;
+    case MOVI:
+        write_register(m, uop->r1, immediate);
+        break;
+    case BEQZ:
+        if (destination == 0)
+        {
+            next_pc = m->PC + 1 + immediate;
+            stats->taken_branches++;
+        }
+        break;
+    case ANDI:
+        result = (int8_t)(destination & immediate);
+        update_flags(m, ANDI, destination, immediate, result);
+        write_register(m, uop->r1, (int8_t)result);
+        break;
+    case EOR:
+        result = (int8_t)(destination ^ source);
+        update_flags(m, EOR, destination, source, result);
+        write_register(m, uop->r1, (int8_t)result);
+        break;
+    case BR:
+        next_pc = ((uint16_t)(uint8_t)destination << 8) | (uint8_t)source;
+        stats->taken_branches++;
+        break;
+    case SAL:
+        result = isa_shift_left(destination, (uint8_t)immediate);
+        update_flags(m, SAL, destination, immediate, result);
+        write_register(m, uop->r1, (int8_t)result);
+        break;
+    case SAR:
+        result = isa_shift_right(destination, (uint8_t)immediate);
+        update_flags(m, SAR, destination, immediate, result);
+        write_register(m, uop->r1, (int8_t)result);
+        break;
+    case LDR:
+        write_register(m, uop->r1, read_data(m, (uint8_t)immediate));
+        break;
+    case STR:
+        write_data(m, (uint8_t)immediate, destination);
+        break;
+    default:
+        fprintf(stderr, "Error: Unknown opcode %d\n", uop->opcode);
+        break;
+    }
+
+    m->PC = next_pc;
+    stats->retired++;
+    if (m->hooks.active != 0)
+        hooks_retire(m, pc, read_instruction(m, pc), old_sreg, pc + 1);
+    return 1;
+}
+
+// Function to execute from PC until the end of the program or until
+// max_instructions have retired (0: no limit)
+void functional_run(machine_t *m, long long max_instructions, functional_stats_t *stats)
+{
+    long long budget_end = stats->retired + max_instructions;
+
+    while (max_instructions <= 0 || stats->retired < budget_end)
+    {
+        if (!functional_step(m, stats))
+            break;
+    }
+}
+
+// Function to estimate the cycles the pipeline model would take for a run:
+// one execute cycle per instruction, plus the fill and drain of the three
+// stages and the flush bubbles of every taken branch
+long long estimate_pipeline_cycles(const functional_stats_t *stats)
+{
+    return PIPELINE_FILL_CYCLES + stats->retired + PIPELINE_DRAIN_CYCLES +
+           BRANCH_PENALTY_CYCLES * stats->taken_branches;
+}
@@ -0,0 +1,159 @@
+#include "hooks.h"
+#include "machine.h"
+#include "flags.h"
+#include "log.h"
+
+// Helper function to recompute the union of the subscribed events
+static void update_active(hooks_t *hooks)
+{
+    hooks->active = 0;
+    for (int i = 0; i < hooks->count; i++)
+        hooks->active |= hooks->subscribers[i].events;
+}
+
+// Function to subscribe a callback to a set of events
+int hooks_subscribe(machine_t *m, uint32_t events, hook_callback_t callback, void *context)
+{
+    hooks_t *hooks = &m->hooks;
+    if (hooks->count >= HOOK_MAX_SUBSCRIBERS)
+    {
+        fprintf(stderr, "Error: More than %d hook subscribers\n", HOOK_MAX_SUBSCRIBERS);
+        return 0;
+    }
+
+    hooks->subscribers[hooks->count].callback = callback;
+    hooks->subscribers[hooks->count].context = context;
+    hooks->subscribers[hooks->count].events = events & HOOK_ALL_EVENTS;
+    hooks->count++;
+    update_active(hooks);
+    return 1;
+}
+
+// Function to remove every subscription of a callback and context
+void hooks_unsubscribe(machine_t *m, hook_callback_t callback, void *context)
+{
+    hooks_t *hooks = &m->hooks;
+    int kept = 0;
+    for (int i = 0; i < hooks->count; i++)
+    {
+        if (hooks->subscribers[i].callback != callback || hooks->subscribers[i].context != context)
+            hooks->subscribers[kept++] = hooks->subscribers[i];
+    }
+    hooks->count = kept;
+    update_active(hooks);
+}
+
+// Function to pass an event to its subscribers, in subscription order
+void hooks_emit(machine_t *m, const hook_event_t *event)
+{
+    const hooks_t *hooks = &m->hooks;
+    for (int i = 0; i < hooks->count; i++)
+    {
+        if (hooks->subscribers[i].events & HOOK_BIT(event->type))
+            hooks->subscribers[i].callback(hooks->subscribers[i].context, m, event);
+    }
+}
+
+// Function to note a register or memory write in the dirty journal
+void hooks_journal(machine_t *m, hook_type_t type, uint16_t index, data_word_t old_value)
+{
+    hooks_t *hooks = &m->hooks;
+    if (hooks->journal_count >= HOOK_JOURNAL_SIZE)
+        return; // No instruction writes this much; drop the rest rather than overrun
+
+    hook_write_t *write = &hooks->journal[hooks->journal_count++];
+    write->type = (uint8_t)type;
+    write->index = index;
+    write->old_value = old_value;
+}
+
+// Function to report an instruction that has finished executing
+void hooks_retire(machine_t *m, instruction_word_t pc, instruction_word_t instruction, data_word_t old_sreg,
+                  instruction_word_t expected_pc)
+{
+    hooks_t *hooks = &m->hooks;
+    hook_event_t event = {0};
+    event.cycle = m->cycle;
+    event.pc = pc;
+    event.instruction = instruction;
+
+    // The journal holds old values; the new ones are what the state holds now
+    for (int i = 0; i < hooks->journal_count; i++)
+    {
+        const hook_write_t *write = &hooks->journal[i];
+        event.type = (hook_type_t)write->type;
+        event.index = write->index;
+        event.old_value = write->old_value;
+        event.new_value = write->type == HOOK_REGISTER_WRITE ? m->register_file[write->index]
+                                                             : read_data(m, write->index);
+        hooks_emit(m, &event);
+    }
+    hooks->journal_count = 0;
+    event.index = 0;
+
+    data_word_t sreg = read_sreg(m);
+    if ((hooks->active & HOOK_BIT(HOOK_SREG_CHANGE)) && sreg != old_sreg)
+    {
+        event.type = HOOK_SREG_CHANGE;
+        event.old_value = (uint8_t)old_sreg;
+        event.new_value = (uint8_t)sreg;
+        hooks_emit(m, &event);
+    }
+
+    if ((hooks->active & HOOK_BIT(HOOK_PC_REDIRECT)) && m->PC != expected_pc)
+    {
+        event.type = HOOK_PC_REDIRECT;
+        event.old_value = expected_pc;
+        event.new_value = m->PC;
+        hooks_emit(m, &event);
+    }
+
+    if (hooks->active & HOOK_BIT(HOOK_RETIRE))
+    {
+        event.type = HOOK_RETIRE;
+        event.old_value = 0;
+        event.new_value = 0;
+        hooks_emit(m, &event);
+    }
+}
+
+// Function to report a pipeline stall cycle
+void hooks_stall(machine_t *m, trace_stall_t kind, int cycles_left, instruction_word_t pc,
+                 instruction_word_t instruction)
+{
+    hook_event_t event = {0};
+    event.type = HOOK_STALL;
+    event.cycle = m->cycle;
+    event.pc = pc;
+    event.instruction = instruction;
+    event.index = (uint16_t)kind;
+    event.new_value = cycles_left;
+    hooks_emit(m, &event);
+}
+
+// Subscriber that prints the changes an instruction made as stage log lines
+void hooks_log_changes(void *context, const machine_t *m, const hook_event_t *event)
+{
+    (void)context;
+    (void)m;
+    switch (event->type)
+    {
+    case HOOK_REGISTER_WRITE:
+        if (event->new_value != event->old_value)
+            log_stage("  Register Change in Execute Stage: R%d changed from %d to %d\n", event->index,
+                      event->old_value, event->new_value);
+        break;
+    case HOOK_MEMORY_WRITE:
+        log_stage("Data written to address %u: %d\n", event->index, event->new_value);
+        break;
+    case HOOK_SREG_CHANGE:
+        log_stage("  SREG Change in Execute Stage: Changed from 0x%02X to 0x%02X\n", event->old_value,
+                  event->new_value);
+        break;
+    case HOOK_PC_REDIRECT:
+        log_stage("  PC Change in Execute Stage: Changed from %d to %d\n", event->old_value, event->new_value);
+        break;
+    default:
+        break;
+    }
+}
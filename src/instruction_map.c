@@ -1,19 +1,22 @@
 #include "instruction_map.h"
+#include "isa_hash.h" // Generated at build time by tools/isa_gen.c
+
+const isa_info_t isa_table[ISA_OPCODE_SLOTS] = {
+#define ISA_INFO(name, opcode, format, signed_immediate, flags, operands) \
+    [opcode] = {#name, format, (signed_immediate) ? 0x20 : 0, flags, operands},
+    ISA_OPCODES(ISA_INFO)
+#undef ISA_INFO
+};
+
+// Function to look up a mnemonic of the given length
+Instruction lookup_mnemonic(const char *text, size_t length)
+{
+    uint64_t key = isa_mnemonic_key(text, length);
+    uint32_t slot = isa_hash_slot(key, ISA_HASH_MULTIPLIER, ISA_HASH_BITS);
+    return (key != 0 && isa_hash_keys[slot] == key) ? (Instruction)isa_hash_opcodes[slot] : INVALID_INSTRUCTION;
+}
 
 // Function to get the enum value from instruction text
 Instruction get_instruction_enum(const char* instruction_text) {
-    if (strcmp(instruction_text, "ADD") == 0) return ADD;
-    if (strcmp(instruction_text, "SUB") == 0) return SUB;
-    if (strcmp(instruction_text, "MUL") == 0) return MUL;
-    if (strcmp(instruction_text, "MOVI") == 0) return MOVI;
-    if (strcmp(instruction_text, "BEQZ") == 0) return BEQZ;
-    if (strcmp(instruction_text, "ANDI") == 0) return ANDI;
-    if (strcmp(instruction_text, "EOR") == 0) return EOR;
-    if (strcmp(instruction_text, "BR") == 0) return BR;
-    if (strcmp(instruction_text, "SAL") == 0) return SAL;
-    if (strcmp(instruction_text, "SAR") == 0) return SAR;
-    if (strcmp(instruction_text, "LDR") == 0) return LDR;
-    if (strcmp(instruction_text, "STR") == 0) return STR;
-
-    return INVALID_INSTRUCTION; // Return invalid for unrecognized instructions
+    return lookup_mnemonic(instruction_text, strlen(instruction_text));
 }
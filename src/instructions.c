@@ -1,512 +1,279 @@
 #include "instructions.h"
 #include "pipeline.h"
 #include "types.h"
+#include "log.h"
 
-// SREG : 000CVNSZ
-// Helper function to update the Carry flag (C)
-void update_carry_flag(int16_t result)
+// Helper function to squash everything fetched or decoded behind a
+// mispredicted branch; the branch itself is still at the head of the ID/EX
+// latch. Fetches that ran past the end of the program were on the wrong
+// path too, so the end-of-program count starts over.
+static void flush_pipeline(machine_t *m)
 {
-    if (result > 127 | result < 0)
-    {
-        SREG |= 0b00010000; // Set the carry flag
-    }
-    else
-    {
-        SREG &= ~0b00010000; // Clear the carry flag
-    }
+    m->counters.flushes++;
+    m->counters.squashed += m->if_id_queue.count + m->id_ex_queue.count - 1;
+    scoreboard_squash(&m->scoreboard, &m->id_ex_queue);
+    flush_queue(&m->if_id_queue);
+    flush_queue(&m->id_ex_queue);
+    m->stop = 0;
+    m->fetch_ready_cycle = 0; // A wrong-path I-cache miss is abandoned
 }
 
-// Helper function to update the Overflow flag (V)
-void update_overflow_flag(Instruction instruction, int8_t destination, int8_t source, int8_t result)
+// Function to run a load or store through the D-cache model; if memory has
+// to be reached, the whole pipeline waits for it and the instructions in
+// flight behind this one complete that much later
+void access_data_cache(machine_t *m, uint16_t address, int write)
 {
-    if (instruction == ADD)
+    int latency = cache_access(&m->dcache, &m->counters.dcache, address, write);
+    if (latency > 0)
     {
-        if (((destination > 0) && (source > 0) && (result < 0)) || ((destination < 0) && (source < 0) && (result > 0)))
-        {
-            SREG |= 0b00001000; // Set the overflow flag
-        }
-        else
-        {
-            SREG &= ~0b00001000; // Clear the overflow flag
-        }
-    }
-    else if (instruction == SUB)
-    {
-        if (((destination < 0) && (source > 0) && (result > 0)) || ((destination > 0) && (source < 0) && (result < 0)))
-        {
-            SREG |= 0b00001000; // Set the overflow flag
-        }
-        else
-        {
-            SREG &= ~0b00001000; // Clear the overflow flag
-        }
+        m->memory_stall = latency;
+        scoreboard_delay(&m->scoreboard, m->cycle, latency);
+        log_stage("  D-cache: the pipeline waits %d cycles for memory\n", latency);
     }
 }
 
-// Helper function to update the Negative flag (N)
-void update_negative_flag(int8_t result)
+// Helper function to resolve a branch in execute: train the predictor and,
+// if fetch did not follow the actual outcome, flush and refetch from next_pc
+static void resolve_branch(machine_t *m, ID_EX *id_ex, int taken, uint16_t next_pc)
 {
-    if (result & 0b10000000)
-    {
-        SREG |= 0b00000100; // Set the negative flag
-    }
-    else
-    {
-        SREG &= ~0b00000100; // Clear the negative flag
-    }
-}
+    m->counters.branches++;
+    m->counters.taken_branches += taken;
+    predictor_update(&m->predictor, id_ex->pc - 1, id_ex->opcode, taken, next_pc);
 
-// Helper function to update the Sign flag (S)
-void update_sign_flag()
-{
-    if (((SREG & 0b00000100) >> 2) ^ ((SREG & 0b00000010) >> 1))
-    {
-        SREG |= 0b00000010; // Set the sign flag
-    }
-    else
+    if (taken == id_ex->predicted_taken && (!taken || next_pc == id_ex->predicted_pc))
     {
-        SREG &= ~0b00000010; // Clear the sign flag
+        if (taken)
+            log_stage("Branch target predicted -> no flush\n");
+        return;
     }
-}
 
-// Helper function to update the Zero flag (Z)
-void update_zero_flag(int8_t result)
-{
-    if (result == 0)
-    {
-        SREG |= 0b00000001; // Set the zero flag
-    }
-    else
+    //flush out previous instructions
+    int squashed = m->if_id_queue.count + m->id_ex_queue.count - 1;
+    flush_pipeline(m);
+    log_stage("Control hazard detected -> Flushing out previous instructions in the fetch and decode stages...\n");
+    m->decode_stall = 1;
+    m->execute_stall = 2;
+    m->PC = next_pc;
+    if (m->trace != NULL)
+        trace_event(m->trace, TRACE_FLUSH, 0, m->cycle, next_pc, id_ex->instruction, 0, (int16_t)squashed);
+    if (m->hooks.active & HOOK_BIT(HOOK_FLUSH))
     {
-        SREG &= ~0b00000001; // Clear the zero flag
+        hook_event_t event = {HOOK_FLUSH, m->cycle, id_ex->pc - 1, id_ex->instruction, next_pc, 0, squashed};
+        hooks_emit(m, &event);
     }
 }
 
-// Helper function to update flags based on the instruction
-void update_flags(Instruction instruction, int8_t destination, int8_t source, int16_t result)
+void _ADD(machine_t *m, ID_EX *id_ex)
 {
-    switch (instruction)
-    {
-    case ADD:
-        update_carry_flag(result);
-        update_overflow_flag(instruction, destination, source, result);
-        update_negative_flag(result);
-        update_sign_flag();
-        update_zero_flag(result);
-        break;
-    case SUB:
-        update_overflow_flag(instruction, destination, source, result);
-        update_negative_flag(result);
-        update_sign_flag();
-        update_zero_flag(result);
-        break;
-    case MUL:
-    case ANDI:
-    case EOR:
-    case SAL:
-    case SAR:
-        update_negative_flag(result);
-        update_zero_flag(result);
-        break;
-    default:
-        // No flags to update for other instructions
-        break;
-    }
-}
-
-void _ADD()
-{
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue)); // Decode to Execute stage
-    data_word_t destination = id_ex.r1_value;
-    data_word_t source = id_ex.r2_value;
-
-    printf("ADD: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", 
-           id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
-
-    // Data hazard forwarding for source operand
-    if (id_ex.data_hazard==1) {
-        if(id_ex.r2_forward==1)
-        source = EX.result;
-        if(id_ex.r1_forward==1)
-        destination = EX.result;
-        printf("Data hazard detected in ADD instruction. Forwarding value: %d...\n", source);
-        id_ex.data_hazard=0;
-    }
+    data_word_t destination = id_ex->r1_value;
+    data_word_t source = id_ex->r2_value;
 
     int16_t result = destination + source;
-    EX.result = result;
+    m->EX.result = result;
 
     // Update relevant flags for ADD
-    update_flags(ADD, destination, source, result);
+    update_flags(m, ADD, destination, source, result);
     //printf("ADD: result=%d\n", result);
 
-    uint8_t rd = id_ex.r1;
-    write_register(rd, (int8_t)result);
+    uint8_t rd = id_ex->r1;
+    write_register(m, rd, (int8_t)result);
 
-    printf("ADD: R%u = %d + %d = %d\n", rd, destination, source, result);
+    log_stage("ADD: R%u = %d + %d = %d\n", rd, destination, source, result);
 }
 
-void _SUB()
+void _SUB(machine_t *m, ID_EX *id_ex)
 {
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue));
-    data_word_t destination = id_ex.r1_value;
-    data_word_t source = id_ex.r2_value;
-
-    printf("SUB: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", 
-           id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
-
-    // Data hazard forwarding
-    if (id_ex.data_hazard==1) {
-        if(id_ex.r1_forward==1)
-            destination = EX.result;
-        if(id_ex.r2_forward==1) 
-            source = EX.result;
-        printf("Data hazard detected in SUB instruction. Forwarding value: %d...\n", 
-               (id_ex.r1_forward==1) ? destination : source);
-        id_ex.data_hazard=0;
-    }
+    data_word_t destination = id_ex->r1_value;
+    data_word_t source = id_ex->r2_value;
 
     int16_t result = destination - source;
-    EX.result = result;
+    m->EX.result = result;
     
-    update_flags(SUB, destination, source, result);
+    update_flags(m, SUB, destination, source, result);
 
-    uint8_t rd = id_ex.r1;
-    write_register(rd, (int8_t)result);
+    uint8_t rd = id_ex->r1;
+    write_register(m, rd, (int8_t)result);
 
-    printf("SUB: R%u = %d - %d = %d\n", rd, destination, source, result);
+    log_stage("SUB: R%u = %d - %d = %d\n", rd, destination, source, result);
 }
 
-void _MUL()
+void _MUL(machine_t *m, ID_EX *id_ex)
 {
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue));
-    data_word_t destination = id_ex.r1_value;
-    data_word_t source = id_ex.r2_value;
-
-    printf("MUL: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", 
-           id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
-
-    // Data hazard forwarding
-    if (id_ex.data_hazard==1) {
-        if(id_ex.r1_forward==1)
-            destination = EX.result;
-        if(id_ex.r2_forward==1) 
-            source = EX.result;
-        printf("Data hazard detected in MUL instruction. Forwarding value: %d...\n", 
-               (id_ex.r1_forward==1) ? destination : source);
-        id_ex.data_hazard=0;
-    }
+    data_word_t destination = id_ex->r1_value;
+    data_word_t source = id_ex->r2_value;
 
     int16_t result = destination * source;
-    EX.result = result;
+    m->EX.result = result;
 
-    update_flags(MUL, destination, source, result);
+    update_flags(m, MUL, destination, source, result);
 
-    uint8_t rd = id_ex.r1;
-    write_register(rd, (int8_t)result);
+    uint8_t rd = id_ex->r1;
+    write_register(m, rd, (int8_t)result);
 
-    printf("MUL: R%u = %d * %d = %d\n", rd, destination, source, result);
+    log_stage("MUL: R%u = %d * %d = %d\n", rd, destination, source, result);
 }
 
-void _MOVI()
+void _MOVI(machine_t *m, ID_EX *id_ex)
 {
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue)); // Decode to Execute stage
-    uint8_t rd = id_ex.r1;
-    int8_t immediate = id_ex.immediate;
-    
-    printf("MOVI: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", 
-           id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
-    
-    EX.result = immediate;
+    uint8_t rd = id_ex->r1;
+    int8_t immediate = id_ex->immediate;
+
+    m->EX.result = immediate;
 
     // Move immediate value to register rd
-    write_register(rd, immediate);
+    write_register(m, rd, immediate);
 
-    printf("MOVI: R%u = %d\n", rd, immediate);
+    log_stage("MOVI: R%u = %d\n", rd, immediate);
 }
 
-void _BEQZ()
+void _BEQZ(machine_t *m, ID_EX *id_ex)
 {
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue)); // Decode to Execute stage
-    int8_t value = id_ex.r1_value;
-    int8_t immediate = id_ex.immediate;
-    
-    printf("BEQZ: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", 
-           id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
-    
-    // Add data hazard forwarding for r1
-    if (id_ex.data_hazard==1) {
-        if(id_ex.r1_forward==1) {
-            value = EX.result;
-            printf("Data hazard detected in BEQZ instruction. Forwarding value: %d...\n", value);
-        }
-        id_ex.data_hazard=0;
-    }
-    
-    EX.result = immediate;
+    int8_t value = id_ex->r1_value;
+    int8_t immediate = id_ex->immediate;
+
+    m->EX.result = immediate;
     
-    if (value == 0)
-    {
-        while (!isEmpty(&if_id_queue))
-        {
-            dequeue_if_id(&if_id_queue);
-        }
-        //flush out previous instructions
-        while (!isEmpty(&id_ex_queue))
-        {
-            dequeue_id_ex(&id_ex_queue);
-        }
-        printf("Control hazard detected -> Flushing out previous instructions in the fetch and decode stages...\n");
-        decode_stall = 1;
-        execute_stall = 2;
-        PC = id_ex.pc + immediate;
-    }
-    // id_ex.data_hazard=0;
+    // Taken: the PC after the branch plus the offset; not taken: the next instruction
+    int taken = value == 0;
+    resolve_branch(m, id_ex, taken, taken ? (uint16_t)(id_ex->pc + immediate) : id_ex->pc);
 
-    printf("BEQZ: R%u = %d, PC = %d\n", id_ex.r1, value, PC);
+    log_stage("BEQZ: R%u = %d, PC = %d\n", id_ex->r1, value, m->PC);
 }
 
-void _ANDI()
+void _ANDI(machine_t *m, ID_EX *id_ex)
 {
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue));
-    int8_t destination = id_ex.r1_value;
-    int8_t immediate = id_ex.immediate;
-
-    printf("ANDI: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", 
-           id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
-
-    // Data hazard forwarding - only check r1
-    if (id_ex.data_hazard==1) {
-        if(id_ex.r1_forward==1) {
-            destination = EX.result;
-            printf("Data hazard detected in ANDI instruction. Forwarding value: %d...\n", destination);
-        }
-        id_ex.data_hazard=0;
-    }
+    int8_t destination = id_ex->r1_value;
+    int8_t immediate = id_ex->immediate;
 
     int8_t result = destination & immediate;
-    EX.result = result;
+    m->EX.result = result;
 
     // Update relevant flags for ANDI
-    update_flags(ANDI, destination, immediate, result);
+    update_flags(m, ANDI, destination, immediate, result);
 
-    uint8_t rd = id_ex.r1;
-    write_register(rd, result);
+    uint8_t rd = id_ex->r1;
+    write_register(m, rd, result);
 
-    printf("ANDI: R%u = %d & %d = %d\n", rd, destination, immediate, result);
+    log_stage("ANDI: R%u = %d & %d = %d\n", rd, destination, immediate, result);
 }
 
-void _EOR()
+void _EOR(machine_t *m, ID_EX *id_ex)
 {
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue));
-    int8_t destination = id_ex.r1_value;
-    int8_t source = id_ex.r2_value;
-
-    printf("EOR: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", 
-           id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
-
-    // Data hazard forwarding
-    if (id_ex.data_hazard==1) {
-        if(id_ex.r1_forward==1)
-            destination = EX.result;
-        if(id_ex.r2_forward==1) 
-            source = EX.result;
-        printf("Data hazard detected in EOR instruction. Forwarding value: %d...\n", 
-               (id_ex.r1_forward==1) ? destination : source);
-        id_ex.data_hazard=0;
-    }
+    int8_t destination = id_ex->r1_value;
+    int8_t source = id_ex->r2_value;
 
     int8_t result = destination ^ source;
-    EX.result = result;
+    m->EX.result = result;
 
-    uint8_t rd = id_ex.r1;
-    update_flags(EOR, destination, source, result);
-    write_register(rd, result);
+    uint8_t rd = id_ex->r1;
+    update_flags(m, EOR, destination, source, result);
+    write_register(m, rd, result);
 
-    printf("EOR: R%u = %d ^ %d = %d\n", rd, destination, source, result);
+    log_stage("EOR: R%u = %d ^ %d = %d\n", rd, destination, source, result);
 }
 
-void _BR()
+void _BR(machine_t *m, ID_EX *id_ex)
 {
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue)); // Decode to Execute stage
 
     // Branch Register - set the PC to the concatenated value of registers rd and rs
-    int8_t high_byte = id_ex.r1_value;
-    int8_t low_byte = id_ex.r2_value;
-
-    printf("BR: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", 
-           id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
-
-    // Data hazard forwarding for both registers
-    if (id_ex.data_hazard==1) {
-        // Check if r1 (high byte) needs forwarding
-        if(id_ex.r1_forward==1) {
-            high_byte = EX.result;
-            printf("Data hazard detected in BR instruction. Forwarding high_byte: %d...\n", high_byte);
-        }
-        // Check if r2 (low byte) needs forwarding
-        if(id_ex.r2_forward==1) {
-            low_byte = EX.result;
-            printf("Data hazard detected in BR instruction. Forwarding low_byte: %d...\n", low_byte);
-        }
-        id_ex.data_hazard=0;
-    }
+    int8_t high_byte = id_ex->r1_value;
+    int8_t low_byte = id_ex->r2_value;
 
     // Concatenate the two registers to form a 16-bit address
     uint16_t new_pc = ((uint16_t)(uint8_t)high_byte << 8) | (uint8_t)low_byte;
-    EX.result = new_pc;
+    m->EX.result = new_pc;
     
-    // Flush out previous instructions
-    while (!isEmpty(&if_id_queue)) {
-        dequeue_if_id(&if_id_queue);
-    }
-    while (!isEmpty(&id_ex_queue)) {
-        dequeue_id_ex(&id_ex_queue);
-    }
-   
-    // id_ex.data_hazard=0;
-    decode_stall = 1;
-    execute_stall = 2;
-    printf("Control hazard detected -> Flushing out previous instructions in the fetch and decode stages...\n");
-
-    PC = new_pc;
+    // Always taken; only a BTB hit with the right target avoids the flush
+    resolve_branch(m, id_ex, 1, new_pc);
     
-    printf("BR: PC = %d\n", PC);
+    log_stage("BR: PC = %d\n", m->PC);
 }
 
-void _SAL()
+void _SAL(machine_t *m, ID_EX *id_ex)
 {
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue));
-    int8_t destination = id_ex.r1_value;
-    int8_t immediate = id_ex.immediate;
-
-    printf("SAL: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", 
-           id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
-
-    // Data hazard forwarding - only check r1
-    if (id_ex.data_hazard==1) {
-        if(id_ex.r1_forward==1) {
-            destination = EX.result;
-            printf("Data hazard detected in SAL instruction. Forwarding value: %d...\n", destination);
-        }
-        id_ex.data_hazard=0;
-    }
+    int8_t destination = id_ex->r1_value;
+    int8_t immediate = id_ex->immediate;
 
-    int16_t result = destination << immediate;
-    EX.result = result;
+    int16_t result = isa_shift_left(destination, (uint8_t)immediate);
+    m->EX.result = result;
 
     // Update relevant flags for SAL
-    update_flags(SAL, destination, immediate, result);
+    update_flags(m, SAL, destination, immediate, result);
 
-    uint8_t rd = id_ex.r1;
-    write_register(rd, (int8_t)result);
+    uint8_t rd = id_ex->r1;
+    write_register(m, rd, (int8_t)result);
 
-    printf("SAL: R%u = %d << %d = %d\n", rd, destination, immediate, result);
+    log_stage("SAL: R%u = %d << %d = %d\n", rd, destination, immediate, result);
 }
 
-void _SAR()
+void _SAR(machine_t *m, ID_EX *id_ex)
 {
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue));
-    int8_t destination = id_ex.r1_value;
-    int8_t immediate = id_ex.immediate;
-
-    printf("SAR: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", 
-           id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
-
-    // Data hazard forwarding - only check r1
-    if (id_ex.data_hazard==1) {
-        if(id_ex.r1_forward==1) {
-            destination = EX.result;
-            printf("Data hazard detected in SAR instruction. Forwarding value: %d...\n", destination);
-        }
-        id_ex.data_hazard=0;
-    }
+    int8_t destination = id_ex->r1_value;
+    int8_t immediate = id_ex->immediate;
 
-    int16_t result = destination >> immediate;
-    EX.result = result;
+    int16_t result = isa_shift_right(destination, (uint8_t)immediate);
+    m->EX.result = result;
 
     // Update relevant flags for SAR
-    update_flags(SAR, destination, immediate, result);
+    update_flags(m, SAR, destination, immediate, result);
 
-    uint8_t rd = id_ex.r1;
-    write_register(rd, (int8_t)result);
+    uint8_t rd = id_ex->r1;
+    write_register(m, rd, (int8_t)result);
 
-    printf("SAR: R%u = %d >> %d = %d\n", rd, destination, immediate, result);
+    log_stage("SAR: R%u = %d >> %d = %d\n", rd, destination, immediate, result);
 }
 
-void _LDR()
+void _LDR(machine_t *m, ID_EX *id_ex)
 { 
    
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue)); // Decode to Execute stage
-    uint8_t address = id_ex.immediate;  // Initialize address
+    uint8_t address = id_ex->immediate;  // Initialize address
     int8_t value;
-    uint8_t rd = id_ex.r1;
-
-    printf("LDR: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", 
-           id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
-
-    if (id_ex.data_hazard==1)
-        {
-            value = EX.result;
-            printf("Data hazard detected in LDR instruction. Forwarding Memory Data : %d...\n",value);
-            id_ex.data_hazard=0;
+    uint8_t rd = id_ex->r1;
 
-        }
-    else{
     // Load to Register - load value from memory at address into register rd
-    address = id_ex.immediate;
-    value = read_data(address);
-    }
-    rd = id_ex.r1;
+    value = read_data(m, address);
+    if (m->stages == 3)
+        access_data_cache(m, address, 0); // The 5-stage pipeline times it in MEM
     
     // Store old register value for comparison
-    int8_t old_value = id_ex.r1_value;
-    EX.result = value;
+    int8_t old_value = id_ex->r1_value;
+    m->EX.result = value;
     // Update the register
-    write_register(rd, value);
+    write_register(m, rd, value);
 
-    printf("LDR: Memory[%d] = %d -> R%u\n", address, value, rd);
+    log_stage("LDR: Memory[%d] = %d -> R%u\n", address, value, rd);
     
     // Report register value change
-    printf("  Register Change in Execute Stage: R%d changed from %d to %d\n", 
+    log_stage("  Register Change in Execute Stage: R%d changed from %d to %d\n", 
            rd, old_value, value);
 }
 
-void _STR()  
+void _STR(machine_t *m, ID_EX *id_ex)  
 {
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue)); // Decode to Execute stage
     uint8_t rd ;
     int8_t value ;
-    int8_t address ;
-    
-    printf("STR: data_hazard=%d, r1_forward=%d, r2_forward=%d\n", 
-           id_ex.data_hazard, id_ex.r1_forward, id_ex.r2_forward);
-    
-    if (id_ex.data_hazard==1) {
-        value = EX.result;
-        printf("Data hazard detected in STR instruction. Forwarding Register Value : %d...\n",value);
-        id_ex.data_hazard=0;
-    }
-    
+    uint8_t address ; // Same 8-bit address as LDR
+
     // Store from Register - store value from register rd into memory at address
-   else
-     value = id_ex.r1_value;
+    value = id_ex->r1_value;
     
-    rd = id_ex.r1;
-    address = id_ex.immediate;
+    rd = id_ex->r1;
+    address = id_ex->immediate;
     
     // Store old memory value for comparison
-    int8_t old_value = read_data(address);
-    EX.result = value;
+    int8_t old_value = read_data(m, address);
+    m->EX.result = value;
     // Update the memory
-    write_data(address, value);
+    write_data(m, address, value);
+    if (m->stages == 3)
+        access_data_cache(m, address, 1);
 
     // Print instruction and operands
-    printf("STR: R%u = %d -> Memory[%d]\n", rd, value, address);
+    log_stage("STR: R%u = %d -> Memory[%d]\n", rd, value, address);
     
     // Report memory value change if the value actually changed
     if (old_value != value) {
-        printf("  Memory Change in Execute Stage: Memory[%d] changed from %d to %d\n", 
+        log_stage("  Memory Change in Execute Stage: Memory[%d] changed from %d to %d\n", 
                address, old_value, value);
     }
 }
\ No newline at end of file
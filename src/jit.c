@@ -0,0 +1,621 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jit.h"
+#include "functional.h"
+#include "memory.h"
+#include "decoder.h"
+#include "instructions.h"
+#include "log.h"
+#include "flags.h"
+
+#if defined(__x86_64__) && defined(__unix__)
+#define JIT_NATIVE 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define JIT_NATIVE 0
+#endif
+
+// Translated block entry point: (register file, &SREG, data memory) -> next PC.
+// LDR/STR address data memory with 8-bit offsets, so translated code only
+// ever touches the first data page and is handed that page directly.
+_Static_assert(DATA_PAGE_SIZE >= 256, "JIT loads and stores must stay within the first data page");
+typedef uint32_t (*jit_block_fn)(data_word_t *regs, data_word_t *sreg, data_word_t *dmem);
+
+typedef struct
+{
+    jit_block_fn code;   // NULL when no block has been translated for this address
+    uint16_t length;     // Number of instructions covered by the block
+    uint8_t rejected;    // The first instruction cannot be translated; interpret it
+    uint8_t branch;      // Opcode ending the block (BEQZ/BR), or 0xFF for none
+    uint8_t branch_reg;  // Register tested by a closing BEQZ
+} jit_block_t;
+
+#define JIT_ARENA_SIZE (1 << 20)
+#define JIT_BYTES_PER_INSTR 192 // Upper bound on code emitted for one instruction
+
+// Per-machine translation state: one block cache and code arena per machine
+struct jit_state
+{
+    jit_block_t block_cache[INSTR_MEMORY_SIZE];
+    uint8_t *code_arena; // NULL when native code is unavailable
+    size_t code_used;
+};
+
+#if JIT_NATIVE
+
+// ---------------------------------------------------------------------------
+// x86-64 emitter
+// ---------------------------------------------------------------------------
+
+enum
+{
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+    R8 = 8, R9 = 9, R10 = 10, R11 = 11
+};
+
+// Condition codes for SETcc/CMOVcc
+enum
+{
+    CC_E = 0x4, CC_A = 0x7, CC_S = 0x8, CC_L = 0xC, CC_G = 0xF
+};
+
+// Register roles inside a block: arguments stay in their ABI registers
+#define REG_FILE RDI // data_word_t *regs
+#define REG_SREG RSI // data_word_t *sreg
+#define REG_DMEM RDX // data_word_t *dmem
+#define REG_DST R8   // destination operand, sign-extended
+#define REG_SRC R9   // source operand, sign-extended
+#define REG_FLAGS R10 // C/V/N/Z bits produced by the block
+#define REG_SIGNS R11 // XOR of the results of every ADD/SUB (S flag parity)
+
+typedef struct
+{
+    uint8_t *buf;
+    size_t len;
+} emitter_t;
+
+static void emit8(emitter_t *e, uint8_t byte)
+{
+    e->buf[e->len++] = byte;
+}
+
+static void emit32(emitter_t *e, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        emit8(e, (value >> (8 * i)) & 0xFF);
+}
+
+// REX prefix; force is used for byte registers so SPL..DIL are never ambiguous
+static void emit_rex(emitter_t *e, int w, int reg, int rm, int force)
+{
+    uint8_t rex = 0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3);
+    if (rex != 0x40 || force)
+        emit8(e, rex);
+}
+
+// ModRM for a register-direct operand
+static void emit_modrm_reg(emitter_t *e, int reg, int rm)
+{
+    emit8(e, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// ModRM + disp32 for a [base + disp] memory operand (no RSP/R12 bases used)
+static void emit_modrm_mem(emitter_t *e, int reg, int base, int32_t disp)
+{
+    emit8(e, 0x80 | ((reg & 7) << 3) | (base & 7));
+    emit32(e, (uint32_t)disp);
+}
+
+// op r32, r32 (ALU ops encoded as "op r/m32, r32")
+static void emit_alu_rr(emitter_t *e, uint8_t opcode, int dst, int src)
+{
+    emit_rex(e, 0, src, dst, 0);
+    emit8(e, opcode);
+    emit_modrm_reg(e, src, dst);
+}
+
+#define emit_add(e, dst, src) emit_alu_rr(e, 0x01, dst, src)
+#define emit_or(e, dst, src) emit_alu_rr(e, 0x09, dst, src)
+#define emit_and(e, dst, src) emit_alu_rr(e, 0x21, dst, src)
+#define emit_sub(e, dst, src) emit_alu_rr(e, 0x29, dst, src)
+#define emit_xor(e, dst, src) emit_alu_rr(e, 0x31, dst, src)
+#define emit_mov(e, dst, src) emit_alu_rr(e, 0x89, dst, src)
+#define emit_test(e, a, b) emit_alu_rr(e, 0x85, a, b)
+
+// test r8, r8
+static void emit_test8(emitter_t *e, int a, int b)
+{
+    emit_rex(e, 0, b, a, 1);
+    emit8(e, 0x84);
+    emit_modrm_reg(e, b, a);
+}
+
+// imul r32, r32
+static void emit_imul(emitter_t *e, int dst, int src)
+{
+    emit_rex(e, 0, dst, src, 0);
+    emit8(e, 0x0F);
+    emit8(e, 0xAF);
+    emit_modrm_reg(e, dst, src);
+}
+
+// op r32, imm32 (group 1: /1 or, /4 and, /7 cmp)
+static void emit_alu_imm(emitter_t *e, int ext, int dst, int32_t imm)
+{
+    emit_rex(e, 0, 0, dst, 0);
+    emit8(e, 0x81);
+    emit_modrm_reg(e, ext, dst);
+    emit32(e, (uint32_t)imm);
+}
+
+#define emit_and_imm(e, dst, imm) emit_alu_imm(e, 4, dst, imm)
+#define emit_cmp_imm(e, dst, imm) emit_alu_imm(e, 7, dst, imm)
+
+// shift r32, imm8 (group 2: /4 shl, /5 shr, /7 sar)
+static void emit_shift_imm(emitter_t *e, int ext, int dst, uint8_t count)
+{
+    emit_rex(e, 0, 0, dst, 0);
+    emit8(e, 0xC1);
+    emit_modrm_reg(e, ext, dst);
+    emit8(e, count);
+}
+
+#define emit_shl(e, dst, n) emit_shift_imm(e, 4, dst, n)
+#define emit_shr(e, dst, n) emit_shift_imm(e, 5, dst, n)
+#define emit_sar(e, dst, n) emit_shift_imm(e, 7, dst, n)
+
+// setcc r8
+static void emit_setcc(emitter_t *e, int cc, int dst)
+{
+    emit_rex(e, 0, 0, dst, 1);
+    emit8(e, 0x0F);
+    emit8(e, 0x90 | cc);
+    emit_modrm_reg(e, 0, dst);
+}
+
+// cmovcc r32, r32
+static void emit_cmov(emitter_t *e, int cc, int dst, int src)
+{
+    emit_rex(e, 0, dst, src, 0);
+    emit8(e, 0x0F);
+    emit8(e, 0x40 | cc);
+    emit_modrm_reg(e, dst, src);
+}
+
+// mov r32, imm32
+static void emit_mov_imm(emitter_t *e, int dst, uint32_t imm)
+{
+    emit_rex(e, 0, 0, dst, 0);
+    emit8(e, 0xB8 | (dst & 7));
+    emit32(e, imm);
+}
+
+// movsx r32, byte [base + disp]
+static void emit_load_sx8(emitter_t *e, int dst, int base, int32_t disp)
+{
+    emit_rex(e, 0, dst, base, 0);
+    emit8(e, 0x0F);
+    emit8(e, 0xBE);
+    emit_modrm_mem(e, dst, base, disp);
+}
+
+// movzx r32, byte [base + disp]
+static void emit_load_zx8(emitter_t *e, int dst, int base, int32_t disp)
+{
+    emit_rex(e, 0, dst, base, 0);
+    emit8(e, 0x0F);
+    emit8(e, 0xB6);
+    emit_modrm_mem(e, dst, base, disp);
+}
+
+// mov byte [base + disp], r8
+static void emit_store8(emitter_t *e, int base, int32_t disp, int src)
+{
+    emit_rex(e, 0, src, base, 1);
+    emit8(e, 0x88);
+    emit_modrm_mem(e, src, base, disp);
+}
+
+// mov byte [base + disp], imm8
+static void emit_store8_imm(emitter_t *e, int base, int32_t disp, uint8_t imm)
+{
+    emit_rex(e, 0, 0, base, 0);
+    emit8(e, 0xC6);
+    emit_modrm_mem(e, 0, base, disp);
+    emit8(e, imm);
+}
+
+// dst = (cond_reg <cc> 0) as 0/1, where the test is done on a 32-bit register
+static void emit_flag_test(emitter_t *e, int dst, int reg, int cc)
+{
+    emit_xor(e, dst, dst);
+    emit_test(e, reg, reg);
+    emit_setcc(e, cc, dst);
+}
+
+// scratch = (reg1 <cc1> 0) && (reg2 <cc2> 0) && (reg3 <cc3> 0) as 0/1; RBP is
+// clobbered as a second temporary
+static void emit_and3_flag(emitter_t *e, int reg1, int cc1, int reg2, int cc2,
+                           int reg3, int cc3, int scratch)
+{
+    emit_flag_test(e, scratch, reg1, cc1);
+    emit_flag_test(e, RBP, reg2, cc2);
+    emit_and(e, scratch, RBP);
+    emit_flag_test(e, RBP, reg3, cc3);
+    emit_and(e, scratch, RBP);
+}
+
+// Carry flag of ADD: the 16-bit result is above 127 or negative
+static void emit_carry_flag(emitter_t *e)
+{
+    emit_xor(e, RCX, RCX);
+    emit_cmp_imm(e, RAX, 127);
+    emit_setcc(e, CC_A, RCX);
+    emit_shl(e, RCX, 4);
+    emit_or(e, REG_FLAGS, RCX);
+}
+
+// Overflow flag of ADD/SUB, matching update_overflow_flag() exactly (strict
+// comparisons against zero on the operands and the truncated 8-bit result)
+static void emit_overflow_flag(emitter_t *e, Opcode opcode)
+{
+    // RBX holds the 8-bit result sign-extended for the result comparisons
+    emit_rex(e, 0, RBX, RAX, 1);
+    emit8(e, 0x0F);
+    emit8(e, 0xBE);
+    emit_modrm_reg(e, RBX, RAX); // movsx ebx, al
+
+    // ADD: (d > 0 && s > 0 && r < 0) || (d < 0 && s < 0 && r > 0)
+    // SUB: (d < 0 && s > 0 && r > 0) || (d > 0 && s < 0 && r < 0)
+    int dest_cc1 = (opcode == ADD) ? CC_G : CC_L;
+    int dest_cc2 = (opcode == ADD) ? CC_L : CC_G;
+    int source_cc1 = CC_G;
+    int source_cc2 = CC_L;
+    int result_cc1 = (opcode == ADD) ? CC_L : CC_G;
+    int result_cc2 = (opcode == ADD) ? CC_G : CC_L;
+
+    emit_and3_flag(e, REG_DST, dest_cc1, REG_SRC, source_cc1, RBX, result_cc1, RCX);
+    emit8(e, 0x52); // push rdx: borrowed as scratch for the second term
+    emit_and3_flag(e, REG_DST, dest_cc2, REG_SRC, source_cc2, RBX, result_cc2, RDX);
+    emit_or(e, RCX, RDX);
+    emit8(e, 0x5A); // pop rdx
+    emit_shl(e, RCX, 3);
+    emit_or(e, REG_FLAGS, RCX);
+}
+
+// Negative and Zero flags of the 8-bit result held in AL
+static void emit_negative_zero_flags(emitter_t *e)
+{
+    emit_xor(e, RCX, RCX);
+    emit_test8(e, RAX, RAX);
+    emit_setcc(e, CC_S, RCX);
+    emit_shl(e, RCX, 2);
+    emit_or(e, REG_FLAGS, RCX);
+
+    emit_xor(e, RCX, RCX);
+    emit_test8(e, RAX, RAX);
+    emit_setcc(e, CC_E, RCX);
+    emit_or(e, REG_FLAGS, RCX);
+}
+
+// Function to make the arena writable (1) or executable (0)
+static int set_arena_writable(jit_state_t *jit, int writable)
+{
+    int prot = writable ? (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC);
+    return mprotect(jit->code_arena, JIT_ARENA_SIZE, prot) == 0;
+}
+
+// Function to drop every translated block and recycle the arena
+static void flush_all_blocks(jit_state_t *jit)
+{
+    memset(jit->block_cache, 0, sizeof(jit->block_cache));
+    jit->code_used = 0;
+}
+
+// Function to translate the block starting at the given address
+static int compile_block(machine_t *m, uint16_t start)
+{
+    jit_state_t *jit = m->jit;
+    // Scan the block: stop before an undefined word or an opcode we cannot
+    // translate, and after a branch
+    uint16_t length = 0;
+    int ends_with_branch = 0;
+    for (uint16_t address = start; address < INSTR_MEMORY_SIZE && length < JIT_MAX_BLOCK; address++)
+    {
+        if (m->instr_memory[address] == UNDEFINED_INT16)
+            break;
+        const decoded_instr_t *uop = read_decoded_instruction(m, address);
+        if (uop->opcode > STR)
+            break;
+        length++;
+        if (uop->opcode == BEQZ || uop->opcode == BR)
+        {
+            ends_with_branch = 1;
+            break;
+        }
+    }
+
+    if (length == 0)
+    {
+        jit->block_cache[start].rejected = 1;
+        return 0;
+    }
+
+    // Flags are only materialised for the last instruction that writes each
+    // bit; S depends on every ADD/SUB, so their results are XOR-accumulated
+    int last_carry = -1, last_overflow = -1, last_nz = -1;
+    for (int i = 0; i < length; i++)
+    {
+        Opcode opcode = read_decoded_instruction(m, start + i)->opcode;
+        if (opcode == ADD)
+            last_carry = i;
+        if (opcode == ADD || opcode == SUB)
+            last_overflow = i;
+        if (opcode == ADD || opcode == SUB || opcode == MUL || opcode == ANDI ||
+            opcode == EOR || opcode == SAL || opcode == SAR)
+            last_nz = i;
+    }
+
+    size_t capacity = (size_t)length * JIT_BYTES_PER_INSTR + 128;
+    if (jit->code_used + capacity > JIT_ARENA_SIZE)
+        flush_all_blocks(jit);
+
+    uint8_t scratch[JIT_MAX_BLOCK * JIT_BYTES_PER_INSTR + 128];
+    emitter_t e = {scratch, 0};
+
+    // Prologue: RBX and RBP are callee-saved scratch registers
+    emit8(&e, 0x53); // push rbx
+    emit8(&e, 0x55); // push rbp
+    emit_xor(&e, REG_FLAGS, REG_FLAGS);
+    emit_xor(&e, REG_SIGNS, REG_SIGNS);
+
+    for (int i = 0; i < length; i++)
+    {
+        uint16_t address = start + i;
+        const decoded_instr_t *uop = read_decoded_instruction(m, address);
+        int32_t r1 = uop->r1;
+        int32_t r2 = uop->r2;
+        int8_t immediate = uop->immediate;
+        int writes_result = 1;
+
+        switch (uop->opcode)
+        {
+        case ADD:
+        case SUB:
+        case MUL:
+        case EOR:
+            emit_load_sx8(&e, REG_DST, REG_FILE, r1);
+            emit_load_sx8(&e, REG_SRC, REG_FILE, r2);
+            emit_mov(&e, RAX, REG_DST);
+            if (uop->opcode == ADD)
+                emit_add(&e, RAX, REG_SRC);
+            else if (uop->opcode == SUB)
+                emit_sub(&e, RAX, REG_SRC);
+            else if (uop->opcode == MUL)
+                emit_imul(&e, RAX, REG_SRC);
+            else
+                emit_xor(&e, RAX, REG_SRC);
+            break;
+        case ANDI:
+            emit_load_sx8(&e, RAX, REG_FILE, r1);
+            emit_and_imm(&e, RAX, immediate);
+            break;
+        case SAL: // Counts of 8 or more shift every bit out (isa_shift_left)
+            if ((uint8_t)immediate < 8)
+            {
+                emit_load_sx8(&e, RAX, REG_FILE, r1);
+                emit_shl(&e, RAX, (uint8_t)immediate);
+            }
+            else
+                emit_xor(&e, RAX, RAX);
+            break;
+        case SAR: // Counts of 8 or more leave only sign bits (isa_shift_right)
+            emit_load_sx8(&e, RAX, REG_FILE, r1);
+            emit_sar(&e, RAX, (uint8_t)immediate < 8 ? (uint8_t)immediate : 7);
+            break;
+        case MOVI:
+            emit_store8_imm(&e, REG_FILE, r1, (uint8_t)immediate);
+            writes_result = 0;
+            break;
+        case LDR:
+            emit_load_zx8(&e, RAX, REG_DMEM, (uint8_t)immediate);
+            emit_store8(&e, REG_FILE, r1, RAX);
+            writes_result = 0;
+            break;
+        case STR:
+            emit_load_zx8(&e, RAX, REG_FILE, r1);
+            emit_store8(&e, REG_DMEM, (uint8_t)immediate, RAX);
+            writes_result = 0;
+            break;
+        default: // BEQZ/BR are emitted after the flag epilogue
+            writes_result = 0;
+            break;
+        }
+
+        if (!writes_result)
+            continue;
+
+        emit_store8(&e, REG_FILE, r1, RAX);
+
+        if (i == last_carry)
+            emit_carry_flag(&e);
+        if (i == last_overflow)
+            emit_overflow_flag(&e, uop->opcode);
+        if (i == last_nz)
+            emit_negative_zero_flags(&e);
+        if (uop->opcode == ADD || uop->opcode == SUB)
+            emit_xor(&e, REG_SIGNS, RAX);
+    }
+
+    // Epilogue: merge the produced flag bits into SREG
+    uint8_t written = (last_carry >= 0 ? 0x10 : 0) | (last_overflow >= 0 ? 0x08 : 0) |
+                      (last_nz >= 0 ? 0x05 : 0);
+    if (written)
+    {
+        emit_load_zx8(&e, RCX, REG_SREG, 0);
+        emit_and_imm(&e, RCX, ~(int32_t)written);
+        emit_or(&e, RCX, REG_FLAGS);
+        if (last_overflow >= 0)
+        {
+            // S ^= parity of the sign bits of every ADD/SUB result
+            emit_shr(&e, REG_SIGNS, 7);
+            emit_and_imm(&e, REG_SIGNS, 1);
+            emit_shl(&e, REG_SIGNS, 1);
+            emit_xor(&e, RCX, REG_SIGNS);
+        }
+        emit_store8(&e, REG_SREG, 0, RCX);
+    }
+
+    // Next PC
+    uint16_t last_address = start + length - 1;
+    const decoded_instr_t *last = read_decoded_instruction(m, last_address);
+    if (ends_with_branch && last->opcode == BEQZ)
+    {
+        uint16_t taken = (uint16_t)(last_address + 1 + last->immediate);
+        emit_load_sx8(&e, RCX, REG_FILE, last->r1);
+        emit_mov_imm(&e, RAX, (uint16_t)(last_address + 1));
+        emit_mov_imm(&e, RBX, taken);
+        emit_test(&e, RCX, RCX);
+        emit_cmov(&e, CC_E, RAX, RBX);
+    }
+    else if (ends_with_branch)
+    {
+        emit_load_zx8(&e, RAX, REG_FILE, last->r1);
+        emit_shl(&e, RAX, 8);
+        emit_load_zx8(&e, RCX, REG_FILE, last->r2);
+        emit_or(&e, RAX, RCX);
+    }
+    else
+    {
+        emit_mov_imm(&e, RAX, (uint16_t)(start + length));
+    }
+
+    emit8(&e, 0x5D); // pop rbp
+    emit8(&e, 0x5B); // pop rbx
+    emit8(&e, 0xC3); // ret
+
+    if (!set_arena_writable(jit, 1))
+        return 0;
+    memcpy(jit->code_arena + jit->code_used, scratch, e.len);
+    if (!set_arena_writable(jit, 0))
+        return 0;
+
+    jit->block_cache[start].code = (jit_block_fn)(void *)(jit->code_arena + jit->code_used);
+    jit->block_cache[start].length = length;
+    jit->block_cache[start].branch = ends_with_branch ? last->opcode : 0xFF;
+    jit->block_cache[start].branch_reg = last->r1;
+    jit->code_used += (e.len + 15) & ~(size_t)15;
+    return 1;
+}
+
+#endif // JIT_NATIVE
+
+// Function to set up the machine's block cache and code arena; returns 1 if
+// native translation is available
+int jit_init(machine_t *m)
+{
+    if (m->jit == NULL)
+    {
+        m->jit = (jit_state_t *)calloc(1, sizeof(jit_state_t));
+        if (m->jit == NULL)
+        {
+            fprintf(stderr, "Error: Failed to allocate memory for the JIT\n");
+            return 0;
+        }
+    }
+
+    jit_state_t *jit = m->jit;
+    memset(jit->block_cache, 0, sizeof(jit->block_cache));
+#if JIT_NATIVE
+    if (jit->code_arena == NULL)
+    {
+        void *arena = mmap(NULL, JIT_ARENA_SIZE, PROT_READ | PROT_EXEC,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena == MAP_FAILED)
+        {
+            log_summary("JIT: native code unavailable, using the interpreter\n");
+            return 0;
+        }
+        jit->code_arena = arena;
+    }
+    jit->code_used = 0;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+// Function to release the machine's code arena and drop every cached block
+void jit_shutdown(machine_t *m)
+{
+    if (m->jit == NULL)
+        return;
+
+#if JIT_NATIVE
+    if (m->jit->code_arena != NULL)
+        munmap(m->jit->code_arena, JIT_ARENA_SIZE);
+#endif
+    free(m->jit);
+    m->jit = NULL;
+}
+
+// Function to drop any translated block that covers the given address
+void jit_invalidate(machine_t *m, uint16_t address)
+{
+    if (m->jit == NULL || address >= INSTR_MEMORY_SIZE)
+        return;
+
+    jit_block_t *block_cache = m->jit->block_cache;
+    block_cache[address].rejected = 0;
+    for (int start = address; start >= 0 && start > address - JIT_MAX_BLOCK; start--)
+    {
+        jit_block_t *block = &block_cache[start];
+        if (block->code != NULL && start + block->length > address)
+        {
+            block->code = NULL;
+            block->length = 0;
+        }
+    }
+}
+
+// Function to execute from PC until an undefined instruction is reached or
+// max_instructions have retired (0: no limit)
+void jit_run(machine_t *m, long long max_instructions, functional_stats_t *stats)
+{
+    long long budget_end = stats->retired + max_instructions;
+    data_word_t *first_page = touch_data_page(m, 0); // All translated code ever loads or stores
+
+    while (max_instructions <= 0 || stats->retired < budget_end)
+    {
+        if (read_instruction(m, m->PC) == UNDEFINED_INT16)
+            break; // End of program
+
+#if JIT_NATIVE
+        // Translated blocks report no hooks, so observed machines interpret
+        if (m->jit != NULL && m->jit->code_arena != NULL && m->hooks.active == 0)
+        {
+            jit_block_t *block = &m->jit->block_cache[m->PC];
+            if (block->code == NULL && !block->rejected)
+                compile_block(m, m->PC);
+
+            // Only run a whole block if it fits within the instruction budget
+            if (block->code != NULL &&
+                (max_instructions <= 0 || stats->retired + block->length <= budget_end))
+            {
+                sync_sreg(m); // The block merges its flags into SREG itself
+                m->PC = (instruction_word_t)block->code(m->register_file, &m->SREG, first_page);
+                stats->retired += block->length;
+
+                // BEQZ is last in its block, so its register still holds the tested value
+                if (block->branch == BR ||
+                    (block->branch == BEQZ && m->register_file[block->branch_reg] == 0))
+                    stats->taken_branches++;
+                continue;
+            }
+        }
+#endif
+        functional_step(m, stats);
+    }
+}
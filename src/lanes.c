@@ -0,0 +1,549 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lanes.h"
+#include "decoder.h"
+#include "flags.h"
+
+// A vector holds the same byte of VECTOR_BYTES lanes, matching the widest
+// byte vectors of the target (AVX-512BW: all 64 lanes, AVX2: 32, else 16), so
+// a row of LANE_COUNT lanes is a few native registers. GCC and Clang use the
+// vector extension; other compilers, or builds with SIM_LANES_SCALAR, get
+// element-wise loops.
+#if defined(__AVX512BW__)
+#define VECTOR_BYTES 64
+#elif defined(__AVX2__)
+#define VECTOR_BYTES 32
+#else
+#define VECTOR_BYTES 16
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(SIM_LANES_SCALAR)
+#define LANES_VECTOR 1
+typedef int8_t lane_vec_t __attribute__((vector_size(VECTOR_BYTES)));
+typedef uint8_t lane_uvec_t __attribute__((vector_size(VECTOR_BYTES)));
+#else
+#define LANES_VECTOR 0
+typedef struct
+{
+    int8_t v[VECTOR_BYTES];
+} lane_vec_t;
+#endif
+
+// Loop over the vectors that make up one row of lanes
+#define FOR_EACH_VECTOR(offset) for (int offset = 0; offset < LANE_COUNT; offset += VECTOR_BYTES)
+
+// ---------------------------------------------------------------------------
+// Lane vector helpers. Comparisons give -1 in the lanes where they hold and
+// 0 elsewhere; arithmetic wraps at 8 bits like the register file. Every
+// address they load or store is VECTOR_BYTES-aligned.
+// ---------------------------------------------------------------------------
+
+#if LANES_VECTOR
+
+// Macros rather than functions, so no vector is ever passed by value
+#define vec_load(row) (*(const lane_vec_t *)(row))
+#define vec_store(row, v) (*(lane_vec_t *)(row) = (v))
+#define vec_splat(x) ((lane_vec_t){0} + (int8_t)(x))
+#define vec_add(a, b) ((lane_vec_t)((lane_uvec_t)(a) + (lane_uvec_t)(b)))
+#define vec_sub(a, b) ((lane_vec_t)((lane_uvec_t)(a) - (lane_uvec_t)(b)))
+#define vec_mul(a, b) ((lane_vec_t)((lane_uvec_t)(a) * (lane_uvec_t)(b)))
+#define vec_and(a, b) ((a) & (b))
+#define vec_or(a, b) ((a) | (b))
+#define vec_xor(a, b) ((a) ^ (b))
+#define vec_shl(a, count) ((lane_vec_t)((lane_uvec_t)(a) << (count)))
+#define vec_sar(a, count) ((a) >> (count))
+#define vec_lt(a, b) ((lane_vec_t)((a) < (b)))
+#define vec_gt(a, b) ((lane_vec_t)((a) > (b)))
+#define vec_eq(a, b) ((lane_vec_t)((a) == (b)))
+#define vec_select(mask, a, b) (((a) & (mask)) | ((b) & ~(mask))) // a where mask is set, else b
+
+#else
+
+#define LANE_LOOP(expr)                      \
+    lane_vec_t r;                            \
+    for (int i = 0; i < VECTOR_BYTES; i++)   \
+        r.v[i] = (int8_t)(expr);             \
+    return r
+
+static inline lane_vec_t vec_load(const int8_t *row)
+{
+    lane_vec_t v;
+    memcpy(&v, row, sizeof(v));
+    return v;
+}
+
+static inline void vec_store(int8_t *row, lane_vec_t v)
+{
+    memcpy(row, &v, sizeof(v));
+}
+
+static inline lane_vec_t vec_splat(int8_t x) { LANE_LOOP(x); }
+static inline lane_vec_t vec_add(lane_vec_t a, lane_vec_t b) { LANE_LOOP((uint8_t)a.v[i] + (uint8_t)b.v[i]); }
+static inline lane_vec_t vec_sub(lane_vec_t a, lane_vec_t b) { LANE_LOOP((uint8_t)a.v[i] - (uint8_t)b.v[i]); }
+static inline lane_vec_t vec_mul(lane_vec_t a, lane_vec_t b) { LANE_LOOP((uint8_t)a.v[i] * (uint8_t)b.v[i]); }
+static inline lane_vec_t vec_and(lane_vec_t a, lane_vec_t b) { LANE_LOOP(a.v[i] & b.v[i]); }
+static inline lane_vec_t vec_or(lane_vec_t a, lane_vec_t b) { LANE_LOOP(a.v[i] | b.v[i]); }
+static inline lane_vec_t vec_xor(lane_vec_t a, lane_vec_t b) { LANE_LOOP(a.v[i] ^ b.v[i]); }
+static inline lane_vec_t vec_shl(lane_vec_t a, int count) { LANE_LOOP((uint8_t)a.v[i] << count); }
+static inline lane_vec_t vec_sar(lane_vec_t a, int count) { LANE_LOOP(a.v[i] >> count); }
+static inline lane_vec_t vec_lt(lane_vec_t a, lane_vec_t b) { LANE_LOOP(-(a.v[i] < b.v[i])); }
+static inline lane_vec_t vec_gt(lane_vec_t a, lane_vec_t b) { LANE_LOOP(-(a.v[i] > b.v[i])); }
+static inline lane_vec_t vec_eq(lane_vec_t a, lane_vec_t b) { LANE_LOOP(-(a.v[i] == b.v[i])); }
+
+// Function to pick a where mask is set and b elsewhere
+static inline lane_vec_t vec_select(lane_vec_t mask, lane_vec_t a, lane_vec_t b)
+{
+    LANE_LOOP((a.v[i] & mask.v[i]) | (b.v[i] & ~mask.v[i]));
+}
+
+#endif // LANES_VECTOR
+
+// ---------------------------------------------------------------------------
+// Lane machine
+// ---------------------------------------------------------------------------
+
+// Function to allocate a lane machine with cleared state
+lane_machine_t *lanes_create(int lane_count)
+{
+    if (lane_count < 1 || lane_count > LANE_COUNT)
+    {
+        fprintf(stderr, "Error: Lane count %d out of range (1-%d)\n", lane_count, LANE_COUNT);
+        return NULL;
+    }
+
+    size_t size = (sizeof(lane_machine_t) + LANE_COUNT - 1) & ~(size_t)(LANE_COUNT - 1);
+    lane_machine_t *lm = (lane_machine_t *)aligned_alloc(LANE_COUNT, size);
+    if (lm == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate memory for the lane machine\n");
+        return NULL;
+    }
+
+    memset(lm, 0, size);
+    for (int i = 0; i < INSTR_MEMORY_SIZE; i++)
+        lm->instr_memory[i] = UNDEFINED_INT16;
+    lm->lane_count = lane_count;
+    return lm;
+}
+
+// Function to free a lane machine
+void lanes_destroy(lane_machine_t *lm)
+{
+    free(lm);
+}
+
+// Function to load the program every lane runs
+void lanes_load_image(lane_machine_t *lm, const sim_image_t *image)
+{
+    memcpy(lm->instr_memory, image->words, sizeof(lm->instr_memory));
+    memcpy(lm->decoded_memory, image->decoded, sizeof(lm->decoded_memory));
+
+    // Data initializers go to every lane
+    for (int address = 0; address < LANE_DATA_SIZE && image->data_count > 0; address++)
+        memset(lm->data_memory[address], image->data[address], LANE_COUNT);
+}
+
+// Function to clear every lane's registers, SREG, data memory, PC and counters
+void lanes_reset(lane_machine_t *lm)
+{
+    memset(lm->registers, 0, sizeof(lm->registers));
+    memset(lm->data_memory, 0, sizeof(lm->data_memory));
+    memset(lm->SREG, 0, sizeof(lm->SREG));
+    memset(lm->running, 0, sizeof(lm->running));
+    memset(lm->PC, 0, sizeof(lm->PC));
+    memset(lm->retired, 0, sizeof(lm->retired));
+    memset(lm->taken_branches, 0, sizeof(lm->taken_branches));
+    lm->shared_pc = 0;
+    lm->diverged = 0;
+}
+
+void lanes_set_register(lane_machine_t *lm, int lane, uint8_t reg_num, data_word_t value)
+{
+    lm->registers[reg_num % REG_COUNT][lane % LANE_COUNT] = value;
+}
+
+data_word_t lanes_get_register(const lane_machine_t *lm, int lane, uint8_t reg_num)
+{
+    return lm->registers[reg_num % REG_COUNT][lane % LANE_COUNT];
+}
+
+void lanes_set_data(lane_machine_t *lm, int lane, uint16_t address, data_word_t value)
+{
+    lm->data_memory[address % LANE_DATA_SIZE][lane % LANE_COUNT] = value;
+}
+
+data_word_t lanes_get_data(const lane_machine_t *lm, int lane, uint16_t address)
+{
+    return lm->data_memory[address % LANE_DATA_SIZE][lane % LANE_COUNT];
+}
+
+// Function to copy a machine's registers, SREG, data memory and PC into a lane
+void lanes_load_machine(lane_machine_t *lm, int lane, const machine_t *m)
+{
+    for (int i = 0; i < REG_COUNT; i++)
+        lm->registers[i][lane] = m->register_file[i];
+    for (int i = 0; i < LANE_DATA_SIZE; i++)
+    {
+        int in_memory = i < (int)m->data_memory_size;
+        lm->data_memory[i][lane] = in_memory ? m->data_pages[i >> DATA_PAGE_BITS][i & DATA_PAGE_MASK] : 0;
+    }
+    lm->SREG[lane] = read_sreg(m);
+    lm->PC[lane] = m->PC;
+}
+
+// Function to copy a lane's registers, SREG, data memory and PC into a machine
+void lanes_store_machine(const lane_machine_t *lm, int lane, machine_t *m)
+{
+    for (int i = 0; i < REG_COUNT; i++)
+        m->register_file[i] = lm->registers[i][lane];
+    for (int i = 0; i < LANE_DATA_SIZE && i < (int)m->data_memory_size; i++)
+    {
+        // Zeros need no storage where the machine has none
+        if (lm->data_memory[i][lane] != 0 || data_page_touched(m, i >> DATA_PAGE_BITS))
+            touch_data_page(m, (uint16_t)i)[i & DATA_PAGE_MASK] = lm->data_memory[i][lane];
+    }
+    write_sreg(m, lm->SREG[lane]);
+    m->PC = lm->PC[lane];
+}
+
+// Function to get one lane's retired instruction and taken branch counts
+void lanes_get_stats(const lane_machine_t *lm, int lane, functional_stats_t *stats)
+{
+    stats->retired = lm->retired[lane];
+    stats->taken_branches = lm->taken_branches[lane];
+}
+
+// Helper function to check whether a PC holds an instruction to execute
+static int has_instruction(const lane_machine_t *lm, instruction_word_t pc)
+{
+    return pc < INSTR_MEMORY_SIZE && lm->instr_memory[pc] != UNDEFINED_INT16;
+}
+
+// Function to execute one instruction in the active lanes of the vector at
+// offset and mark the lanes in which a BEQZ was taken
+static inline void execute_vector(lane_machine_t *lm, const decoded_instr_t *uop, int offset,
+                                  const int8_t *active_lanes, int8_t *taken)
+{
+    lane_vec_t active = vec_load(active_lanes + offset);
+    int8_t *destination = lm->registers[uop->r1] + offset;
+    lane_vec_t d = vec_load(destination);
+    lane_vec_t s = uop->is_r_format ? vec_load(lm->registers[uop->r2] + offset) : vec_splat(0);
+    lane_vec_t imm = vec_splat(uop->immediate);
+    int count = (uint8_t)uop->immediate; // Shift count, see isa_shift_left/isa_shift_right
+    lane_vec_t r;
+    vec_store(taken + offset, vec_splat(0));
+
+    switch (uop->opcode)
+    {
+    case ADD:
+        r = vec_add(d, s);
+        break;
+    case SUB:
+        r = vec_sub(d, s);
+        break;
+    case MUL:
+        r = vec_mul(d, s);
+        break;
+    case ANDI:
+        r = vec_and(d, imm);
+        break;
+    case EOR:
+        r = vec_xor(d, s);
+        break;
+    case SAL:
+        r = count < 8 ? vec_shl(d, count) : vec_splat(0);
+        break;
+    case SAR:
+        r = vec_sar(d, count < 8 ? count : 7);
+        break;
+    case MOVI:
+        vec_store(destination, vec_select(active, imm, d));
+        return;
+    case LDR:
+        vec_store(destination, vec_select(active, vec_load(lm->data_memory[(uint8_t)uop->immediate] + offset), d));
+        return;
+    case STR:
+    {
+        int8_t *row = lm->data_memory[(uint8_t)uop->immediate] + offset;
+        vec_store(row, vec_select(active, d, vec_load(row)));
+        return;
+    }
+    case BEQZ:
+        vec_store(taken + offset, vec_and(active, vec_eq(d, vec_splat(0))));
+        return;
+    case BR:
+        return; // Targets are per lane; see lanes_run
+    default:
+        return; // Unknown opcode: no effect
+    }
+
+    // SREG, as update_flags() sets it: ADD sets C, V, N, S, Z; SUB sets V, N,
+    // S, Z; the logic, multiply and shift instructions set N and Z
+    const lane_vec_t zero = vec_splat(0);
+    lane_vec_t sreg = vec_load(lm->SREG + offset);
+    lane_vec_t negative = vec_lt(r, zero);
+    lane_vec_t flags = vec_or(vec_and(negative, vec_splat(SREG_N)),
+                              vec_and(vec_eq(r, zero), vec_splat(SREG_Z)));
+    int8_t updated = SREG_N | SREG_Z;
+
+    if (uop->opcode == ADD || uop->opcode == SUB)
+    {
+        lane_vec_t positive = vec_gt(r, zero);
+        lane_vec_t overflow;
+        if (uop->opcode == ADD)
+        {
+            // Both operands positive and a negative result, or both negative
+            // and a positive one
+            overflow = vec_or(vec_and(vec_and(vec_gt(d, zero), vec_gt(s, zero)), negative),
+                              vec_and(vec_and(vec_lt(d, zero), vec_lt(s, zero)), positive));
+
+            // The 16-bit sum is outside 0..127 exactly when the 8-bit result is
+            // negative or the signed addition wrapped
+            lane_vec_t wrapped = vec_lt(vec_and(vec_xor(d, r), vec_xor(s, r)), zero);
+            flags = vec_or(flags, vec_and(vec_or(negative, wrapped), vec_splat(SREG_C)));
+            updated |= SREG_C;
+        }
+        else
+        {
+            overflow = vec_or(vec_and(vec_and(vec_lt(d, zero), vec_gt(s, zero)), positive),
+                              vec_and(vec_and(vec_gt(d, zero), vec_lt(s, zero)), negative));
+        }
+        flags = vec_or(flags, vec_and(overflow, vec_splat(SREG_V)));
+
+        // S = N xor the previous S
+        lane_vec_t old_sign = vec_eq(vec_and(sreg, vec_splat(SREG_S)), vec_splat(SREG_S));
+        flags = vec_or(flags, vec_and(vec_xor(negative, old_sign), vec_splat(SREG_S)));
+        updated |= SREG_V | SREG_S;
+    }
+
+    lane_vec_t new_sreg = vec_or(vec_and(sreg, vec_splat((int8_t)~updated)), flags);
+    vec_store(lm->SREG + offset, vec_select(active, new_sreg, sreg));
+    vec_store(destination, vec_select(active, r, d));
+}
+
+// Function to execute one instruction in the active lanes and mark the lanes
+// in which a BEQZ was taken (none for other instructions)
+static void execute_lanes(lane_machine_t *lm, const decoded_instr_t *uop, const int8_t *active_lanes, int8_t *taken)
+{
+    if (uop->opcode > STR)
+        fprintf(stderr, "Error: Unknown opcode %d\n", uop->opcode);
+
+    FOR_EACH_VECTOR(offset)
+    {
+        execute_vector(lm, uop, offset, active_lanes, taken);
+    }
+}
+
+// Helper function to compute the target of a BR in one lane
+static instruction_word_t br_target(const lane_machine_t *lm, const decoded_instr_t *uop, int lane)
+{
+    return ((uint16_t)(uint8_t)lm->registers[uop->r1][lane] << 8) |
+           (uint8_t)lm->registers[uop->r2][lane];
+}
+
+// Helper function to check whether two lane masks are equal
+static int same_lanes(const int8_t *a, const int8_t *b)
+{
+    return memcmp(a, b, LANE_COUNT) == 0;
+}
+
+// Helper function to check whether a BR jumps to the same target in every
+// active lane
+static int uniform_br(const lane_machine_t *lm, const decoded_instr_t *uop, const int8_t *active_lanes, int first)
+{
+    alignas(LANE_COUNT) int8_t same[LANE_COUNT];
+    FOR_EACH_VECTOR(offset)
+    {
+        lane_vec_t high = vec_load(lm->registers[uop->r1] + offset);
+        lane_vec_t low = vec_load(lm->registers[uop->r2] + offset);
+        lane_vec_t equal = vec_and(vec_eq(high, vec_splat(lm->registers[uop->r1][first])),
+                                   vec_eq(low, vec_splat(lm->registers[uop->r2][first])));
+        vec_store(same + offset, vec_and(equal, vec_load(active_lanes + offset)));
+    }
+    return same_lanes(same, active_lanes);
+}
+
+// Function to add the steps run by every running lane while converged to
+// their counters
+static void flush_converged(lane_machine_t *lm, long long *pending, long long *pending_taken)
+{
+    for (int i = 0; i < LANE_COUNT; i++)
+    {
+        if (!lm->running[i])
+            continue;
+        lm->retired[i] += *pending;
+        lm->taken_branches[i] += *pending_taken;
+        lm->PC[i] = lm->shared_pc;
+    }
+    *pending = 0;
+    *pending_taken = 0;
+}
+
+// Function to stop the lanes that ran out of program or budget, then find
+// the first running lane and whether the running lanes are still at
+// different PCs. Returns the first running lane, or -1 when all have stopped.
+static int settle_lanes(lane_machine_t *lm, const long long *budget_end, long long max_instructions)
+{
+    int first = -1;
+    int split = 0;
+    for (int i = 0; i < LANE_COUNT; i++)
+    {
+        if (!lm->running[i])
+            continue;
+        if (!has_instruction(lm, lm->PC[i]) ||
+            (max_instructions > 0 && lm->retired[i] >= budget_end[i]))
+        {
+            lm->running[i] = 0;
+            continue;
+        }
+        if (first < 0)
+            first = i;
+        else if (lm->PC[i] != lm->PC[first])
+            split = 1;
+    }
+
+    if (first >= 0)
+    {
+        lm->diverged = split;
+        lm->shared_pc = lm->PC[first];
+    }
+    return first;
+}
+
+// Function to get how many steps the running lanes can take together before
+// one of them exhausts its budget
+static long long converged_budget(const lane_machine_t *lm, const long long *budget_end, long long max_instructions)
+{
+    long long limit = -1; // No limit
+    if (max_instructions <= 0)
+        return limit;
+
+    for (int i = 0; i < LANE_COUNT; i++)
+    {
+        if (lm->running[i] && (limit < 0 || budget_end[i] - lm->retired[i] < limit))
+            limit = budget_end[i] - lm->retired[i];
+    }
+    return limit;
+}
+
+// Function to run every lane until it reaches the end of the program or has
+// retired max_instructions.
+//
+// While the running lanes are converged their counters are not touched per
+// step: the steps (and taken branches) are counted once in pending and added
+// to every running lane when they diverge, stop or reach a budget.
+long long lanes_run(lane_machine_t *lm, long long max_instructions)
+{
+    long long budget_end[LANE_COUNT];
+    long long steps = 0;
+    long long pending = 0;
+    long long pending_taken = 0;
+
+    // Start every lane that has an instruction at its PC
+    for (int i = 0; i < LANE_COUNT; i++)
+    {
+        budget_end[i] = lm->retired[i] + max_instructions;
+        lm->running[i] = i < lm->lane_count ? -1 : 0;
+    }
+    int first = settle_lanes(lm, budget_end, max_instructions);
+    long long limit = converged_budget(lm, budget_end, max_instructions);
+
+    while (first >= 0)
+    {
+        // Pick the instruction to run and the lanes that run it
+        instruction_word_t pc = lm->shared_pc;
+        alignas(LANE_COUNT) int8_t active_lanes[LANE_COUNT];
+        if (!lm->diverged)
+        {
+            memcpy(active_lanes, lm->running, sizeof(active_lanes));
+        }
+        else
+        {
+            for (int i = 0; i < LANE_COUNT; i++)
+            {
+                if (lm->running[i] && lm->PC[i] < pc)
+                    pc = lm->PC[i];
+            }
+            for (int i = 0; i < LANE_COUNT; i++)
+                active_lanes[i] = (lm->running[i] && lm->PC[i] == pc) ? -1 : 0;
+        }
+
+        decoded_instr_t *uop = &lm->decoded_memory[pc];
+        if (!uop->valid)
+            predecode_instruction(lm->instr_memory[pc], uop);
+
+        alignas(LANE_COUNT) int8_t taken[LANE_COUNT];
+        execute_lanes(lm, uop, active_lanes, taken);
+        steps++;
+
+        instruction_word_t fall_through = pc + 1;
+        instruction_word_t branch_target = pc + 1 + uop->immediate;
+
+        if (!lm->diverged)
+        {
+            // Converged: one PC for every running lane while the branch goes
+            // the same way in all of them
+            pending++;
+            int uniform = 1;
+            instruction_word_t next = fall_through;
+            if (uop->opcode == BEQZ)
+            {
+                if (same_lanes(taken, active_lanes))
+                {
+                    next = branch_target;
+                    pending_taken++;
+                }
+                else if (memchr(taken, -1, LANE_COUNT) != NULL)
+                {
+                    uniform = 0;
+                }
+            }
+            else if (uop->opcode == BR)
+            {
+                uniform = uniform_br(lm, uop, active_lanes, first);
+                next = br_target(lm, uop, first);
+                pending_taken += uniform;
+            }
+
+            if (uniform)
+            {
+                lm->shared_pc = next;
+                if (has_instruction(lm, next) && pending != limit)
+                    continue;
+
+                // End of program or of a lane's budget: count, then stop lanes
+                flush_converged(lm, &pending, &pending_taken);
+                first = settle_lanes(lm, budget_end, max_instructions);
+                limit = converged_budget(lm, budget_end, max_instructions);
+                continue;
+            }
+
+            // The lanes split: count the steps before this one, then fall
+            // through to move each lane on its own
+            pending--;
+            flush_converged(lm, &pending, &pending_taken);
+        }
+
+        // Move each active lane to its own next PC
+        for (int i = 0; i < LANE_COUNT; i++)
+        {
+            if (!active_lanes[i])
+                continue;
+            if (uop->opcode == BR)
+                lm->PC[i] = br_target(lm, uop, i);
+            else
+                lm->PC[i] = taken[i] ? branch_target : fall_through;
+            lm->taken_branches[i] += uop->opcode == BR || taken[i];
+            lm->retired[i]++;
+        }
+
+        // Stop finished lanes and reconverge once every running lane is at
+        // the same PC
+        first = settle_lanes(lm, budget_end, max_instructions);
+        if (!lm->diverged)
+            limit = converged_budget(lm, budget_end, max_instructions);
+    }
+
+    return steps;
+}
@@ -0,0 +1,29 @@
+#include <string.h>
+#include "log.h"
+
+log_level_t log_level = LOG_DEBUG; // Full trace unless told otherwise
+
+static const char *level_names[] = {"off", "summary", "stage", "debug"};
+
+// Function to parse a level name ("off", "summary", "stage", "debug" or 0-3)
+int parse_log_level(const char *name, log_level_t *level)
+{
+    for (int i = LOG_OFF; i <= LOG_DEBUG; i++)
+    {
+        if (strcmp(name, level_names[i]) == 0 ||
+            (name[0] == '0' + i && name[1] == '\0'))
+        {
+            *level = (log_level_t)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to get the name of a log level
+const char *get_log_level_name(log_level_t level)
+{
+    if (level >= LOG_OFF && level <= LOG_DEBUG)
+        return level_names[level];
+    return "unknown";
+}
@@ -0,0 +1,38 @@
+#include <string.h>
+#include "machine.h"
+#include "pipeline.h"
+#include "jit.h"
+
+// Function to allocate a machine with cleared memories and a reset pipeline
+machine_t *machine_create(void)
+{
+    // The latches inside are cache-line aligned, so the machine must be too
+    size_t size = (sizeof(machine_t) + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+    machine_t *m = (machine_t *)aligned_alloc(CACHE_LINE_SIZE, size);
+    if (m == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate memory for the machine\n");
+        return NULL;
+    }
+
+    memset(m, 0, size);
+    m->data_memory_size = DEFAULT_DATA_MEMORY_SIZE;
+    init_memory(m);
+    predictor_init(&m->predictor, PREDICT_NOT_TAKEN, PREDICTOR_DEFAULT_COUNTERS, 0);
+    m->issue_width = 1;
+    m->stages = 3;
+    scoreboard_configure(&m->scoreboard, m->stages);
+    reset_pipeline(m);
+    return m;
+}
+
+// Function to free a machine and everything it owns
+void machine_destroy(machine_t *m)
+{
+    if (m == NULL)
+        return;
+
+    jit_shutdown(m);
+    free_data_memory(m);
+    free(m);
+}
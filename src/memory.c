@@ -1,140 +1,231 @@
 #include "memory.h"
 #include <stdio.h>  // For fprintf
-#include <stdlib.h> // For exit
+#include <stdlib.h> // For calloc and exit
+#include "machine.h"
 #include "pipeline.h"
-
-data_word_t register_file[REG_COUNT];               // Register file (R0-R63)
-data_word_t data_memory[DATA_MEMORY_SIZE];          // Data memory
-instruction_word_t instr_memory[INSTR_MEMORY_SIZE]; // Instruction memory
+#include "log.h"
+#include "jit.h"
 
 // Function to initialize instruction memory
-void init_instr_memory()
+void init_instr_memory(machine_t *m)
 {
     for (int16_t i = 0; i < INSTR_MEMORY_SIZE; i++)
     {
-        instr_memory[i] = UNDEFINED_INT16; // Initialize all instructions to 0
+        m->instr_memory[i] = UNDEFINED_INT16; // Initialize all instructions to 0
+        m->decoded_memory[i].valid = 0;
+    }
+}
+
+// Every untouched data page points here; it is only ever read
+static data_word_t zero_page[DATA_PAGE_SIZE];
+
+// Function to initialize data memory: every page goes back to the zero page
+void init_data_memory(machine_t *m)
+{
+    free_data_memory(m);
+    for (int page = 0; page < DATA_PAGE_COUNT; page++)
+    {
+        m->data_pages[page] = zero_page;
+    }
+}
+
+// Function to release the pages data memory has written
+void free_data_memory(machine_t *m)
+{
+    for (int page = 0; page < DATA_PAGE_COUNT; page++)
+    {
+        if (m->data_pages[page] != zero_page)
+            free(m->data_pages[page]);
+        m->data_pages[page] = NULL;
     }
 }
 
-// Function to initialize data memory
-void init_data_memory()
+// Function to resize data memory; it starts out cleared
+void set_data_memory_size(machine_t *m, uint32_t size)
 {
-    for (int16_t i = 0; i < DATA_MEMORY_SIZE; i++)
+    m->data_memory_size = size;
+    init_data_memory(m);
+}
+
+// What each fault reports, followed by the address or register
+static const char *const fault_messages[] = {
+    [FAULT_INSTRUCTION_READ] = "Instruction memory read out of bounds at address",
+    [FAULT_INSTRUCTION_WRITE] = "Instruction memory write out of bounds at address",
+    [FAULT_DATA_READ] = "Data memory read out of bounds at address",
+    [FAULT_DATA_WRITE] = "Data memory write out of bounds at address",
+    [FAULT_REGISTER_READ] = "Register read out of bounds at register",
+    [FAULT_REGISTER_WRITE] = "Register write out of bounds at register",
+};
+
+// Function to report a guest fault and stop the machine; only the first
+// fault of a run is kept (reset_pipeline clears it)
+void raise_fault(machine_t *m, fault_t fault, uint16_t address)
+{
+    if (m->fault == FAULT_NONE)
+    {
+        fprintf(stderr, "Error: %s %u\n", fault_messages[fault], address);
+        m->fault = fault;
+        m->fault_pc = m->PC;
+        m->fault_address = address;
+    }
+    m->sys_call = 0; // Stops the pipeline; the ISA-level engines stop on UNDEFINED_INT16
+}
+
+// Function to get the page holding a data address for writing, giving it
+// its own storage on the first write
+data_word_t *touch_data_page(machine_t *m, uint16_t address)
+{
+    data_word_t **page = &m->data_pages[address >> DATA_PAGE_BITS];
+    if (*page == zero_page)
     {
-        data_memory[i] = 0; // Initialize all data memory to 0
+        *page = (data_word_t *)calloc(DATA_PAGE_SIZE, sizeof(data_word_t));
+        if (*page == NULL)
+        {
+            fprintf(stderr, "Error: Failed to allocate a data memory page\n");
+            exit(EXIT_FAILURE);
+        }
     }
+    return *page;
+}
+
+// Function to check whether a data page has been written since the last clear
+int data_page_touched(const machine_t *m, uint32_t page)
+{
+    return m->data_pages[page] != zero_page;
 }
 
 // Function to initialize register file
-void init_register_file()
+void init_register_file(machine_t *m)
 {
     for (uint16_t i = 0; i < REG_COUNT; i++)
     {
-        register_file[i] = 0; // Initialize all registers to 0
+        m->register_file[i] = 0; // Initialize all registers to 0
     }
 }
 
-void init_memory()
+void init_memory(machine_t *m)
 {
-    init_instr_memory();  // Initialize instruction memory
-    init_data_memory();   // Initialize data memory
-    init_register_file(); // Initialize register file
+    init_instr_memory(m);  // Initialize instruction memory
+    init_data_memory(m);   // Initialize data memory
+    init_register_file(m); // Initialize register file
 }
 
 // Function to read an instruction from instruction memory
-instruction_word_t read_instruction(uint16_t address)
+instruction_word_t read_instruction(machine_t *m, uint16_t address)
 {
     if (address < INSTR_MEMORY_SIZE)
     {
-        return instr_memory[address];
+        return m->instr_memory[address];
     }
     else
     {
-        fprintf(stderr, "Error: Instruction memory read out of bounds at address %u\n", address);
-        exit(EXIT_FAILURE);
+        raise_fault(m, FAULT_INSTRUCTION_READ, address);
+        return UNDEFINED_INT16;
     }
 }
 
 
-void write_instruction(uint16_t address, instruction_word_t value)
+void write_instruction(machine_t *m, uint16_t address, instruction_word_t value)
+{
+    if (address < INSTR_MEMORY_SIZE)
+    {
+        m->instr_memory[address] = value;
+        m->decoded_memory[address].valid = 0; // Invalidate the stale micro-op
+        jit_invalidate(m, address);            // and any translated block covering it
+    }
+    else
+    {
+        raise_fault(m, FAULT_INSTRUCTION_WRITE, address);
+    }
+}
+
+// Function to read the pre-decoded form of an instruction, decoding it on
+// first use after the word was (re)written
+const decoded_instr_t *read_decoded_instruction(machine_t *m, uint16_t address)
 {
+    static const decoded_instr_t invalid_uop; // What an out-of-bounds read gets
     if (address < INSTR_MEMORY_SIZE)
     {
-        instr_memory[address] = value;
+        decoded_instr_t *uop = &m->decoded_memory[address];
+        if (!uop->valid)
+            predecode_instruction(m->instr_memory[address], uop);
+        return uop;
     }
     else
     {
-        fprintf(stderr, "Error: Instruction memory write out of bounds at address %u\n", address);
-        exit(EXIT_FAILURE);
+        raise_fault(m, FAULT_INSTRUCTION_READ, address);
+        return &invalid_uop;
     }
 }
 
 // Function to read data from data memory
-data_word_t read_data(uint16_t address)
+data_word_t read_data(machine_t *m, uint16_t address)
 {
-    if (address < DATA_MEMORY_SIZE)
+    if (address < m->data_memory_size)
     {
-        return data_memory[address];
+        return m->data_pages[address >> DATA_PAGE_BITS][address & DATA_PAGE_MASK];
     }
     else
     {
-        fprintf(stderr, "Error: Data memory read out of bounds at address %u\n", address);
-        exit(EXIT_FAILURE);
+        raise_fault(m, FAULT_DATA_READ, address);
+        return 0;
     }
 }
 
 // Function to write data to data memory
-void write_data(uint16_t address, data_word_t value)
+void write_data(machine_t *m, uint16_t address, data_word_t value)
 {
-    if (address < DATA_MEMORY_SIZE)
+    if (address < m->data_memory_size)
     {
-        data_memory[address] = value;
-        printf("Data written to address %u: %d\n", address, value);
+        data_word_t *page = touch_data_page(m, address);
+        if (m->hooks.active & HOOK_BIT(HOOK_MEMORY_WRITE))
+            hooks_journal(m, HOOK_MEMORY_WRITE, address, page[address & DATA_PAGE_MASK]);
+        page[address & DATA_PAGE_MASK] = value;
     }
     else
     {
-        fprintf(stderr, "Error: Data memory write out of bounds at address %u\n", address);
-        exit(EXIT_FAILURE);
+        raise_fault(m, FAULT_DATA_WRITE, address);
     }
 }
 
 // Function to read a register value
-data_word_t read_register(uint8_t reg_num)
+data_word_t read_register(machine_t *m, uint8_t reg_num)
 {
     if (reg_num < REG_COUNT && reg_num >= 0)
     {
-        return register_file[reg_num];
+        return m->register_file[reg_num];
     }
     else
     {
-        fprintf(stderr, "Error: Register read out of bounds at register %u\n", reg_num);
-        exit(EXIT_FAILURE);
+        raise_fault(m, FAULT_REGISTER_READ, reg_num);
+        return 0;
     }
 }
 
 // Function to write a value to a register
-void write_register(uint8_t reg_num, data_word_t value)
+void write_register(machine_t *m, uint8_t reg_num, data_word_t value)
 {
     if (reg_num < REG_COUNT && reg_num >= 0)
     {
-        register_file[reg_num] = value;
+        if (m->hooks.active & HOOK_BIT(HOOK_REGISTER_WRITE))
+            hooks_journal(m, HOOK_REGISTER_WRITE, reg_num, m->register_file[reg_num]);
+        m->register_file[reg_num] = value;
     }
     else
     {
-        fprintf(stderr, "Error: Register write out of bounds at register %u\n", reg_num);
-        exit(EXIT_FAILURE);
+        raise_fault(m, FAULT_REGISTER_WRITE, reg_num);
     }
 }
 
 // Function to print data memory contents in formatted form
-void print_instruction_memory(void)
+void print_instruction_memory(machine_t *m)
 {
     printf("\n[Instruction MEMORY]\n");
     int memory_found = 0;
 
     for (uint16_t i = 0; i < INSTR_MEMORY_SIZE; i++)
     {
-        instruction_word_t value = instr_memory[i];
+        instruction_word_t value = m->instr_memory[i];
 
         // Skip if memory location is UNDEFINED_INT16
         if (value == UNDEFINED_INT16)
@@ -171,39 +262,46 @@ void print_instruction_memory(void)
     }
 }
 
-void print_data_memory(void)
+void print_data_memory(machine_t *m)
 {
     printf("\n[Data MEMORY]\n");
     int memory_found = 0;
 
-    for (uint16_t i = 0; i < DATA_MEMORY_SIZE; i++)
+    // Untouched pages hold only zeros, which are not printed anyway
+    for (uint32_t page = 0; page < m->data_memory_size / DATA_PAGE_SIZE; page++)
     {
-        data_word_t value = data_memory[i];
-
-        // Skip if memory location is zero
-        if (value == 0)
+        if (!data_page_touched(m, page))
             continue;
 
-        memory_found = 1;
-        // Print address and hex representation
-        printf("Address 0x%04X: 0x%04X ", i, value);
-        // First 4 bits
-        for (int bit = 8; bit >= 5; bit--)
+        for (uint32_t offset = 0; offset < DATA_PAGE_SIZE; offset++)
         {
-            printf("%d", (value >> bit) & 0x1);
-        }
+            data_word_t value = m->data_pages[page][offset];
 
-        printf(" ");
-        for (int bit = 4; bit >= 0; bit--)
-        {
-            printf("%d", (value >> bit) & 0x1);
-        }
+            // Skip if memory location is zero
+            if (value == 0)
+                continue;
 
-        printf("\n");
+            memory_found = 1;
+            // Print address and hex representation
+            printf("Address 0x%04X: 0x%04X ", page * DATA_PAGE_SIZE + offset, value);
+            // First 4 bits
+            for (int bit = 8; bit >= 5; bit--)
+            {
+                printf("%d", (value >> bit) & 0x1);
+            }
+
+            printf(" ");
+            for (int bit = 4; bit >= 0; bit--)
+            {
+                printf("%d", (value >> bit) & 0x1);
+            }
+
+            printf("\n");
+        }
     }
 
     if (!memory_found)
     {
         printf("No memory locations with non-zero values found.\n");
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,475 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "object.h"
+#include "memory.h"
+#include "hash.h"
+#include "file_map.h"
+#include "assembler.h"
+#include "log.h"
+
+#define ARCHIVE_ALIGN 8 // Objects in an archive start on this boundary
+
+struct archive
+{
+    const uint8_t *data; // Whole file, mapped read-only
+    size_t size;
+    const archive_entry_t *entries;
+    const char *names;
+    uint32_t count;
+};
+
+// Helper function to get the encoded size of an object
+static size_t object_size(const sim_image_t *image, size_t name_size)
+{
+    return sizeof(object_header_t) + image->data_count * sizeof(object_data_t) +
+           image->count * sizeof(instruction_word_t) + name_size;
+}
+
+// Helper function to encode an image as an object into buffer, which must
+// hold object_size() bytes
+static void object_encode(const sim_image_t *image, const char *name, size_t name_size, uint8_t *buffer)
+{
+    object_header_t *header = (object_header_t *)buffer;
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, OBJECT_MAGIC, sizeof(header->magic));
+    header->version = OBJECT_VERSION;
+    header->byte_order = OBJECT_BYTE_ORDER;
+    header->header_size = sizeof(object_header_t);
+    header->instr_count = image->count;
+    header->data_count = image->data_count;
+    header->name_size = (uint16_t)name_size;
+
+    uint8_t *body = buffer + sizeof(object_header_t);
+    object_data_t *records = (object_data_t *)body;
+    int record = 0;
+    for (uint16_t address = 0; address < IMAGE_DATA_SIZE && record < image->data_count; address++)
+    {
+        if (image->data[address] != 0)
+        {
+            object_data_t entry = {address, image->data[address], 0};
+            records[record++] = entry;
+        }
+    }
+
+    uint8_t *words = body + image->data_count * sizeof(object_data_t);
+    memcpy(words, image->words, image->count * sizeof(instruction_word_t));
+    memcpy(words + image->count * sizeof(instruction_word_t), name, name_size);
+
+    size_t body_size = object_size(image, name_size) - sizeof(object_header_t);
+    header->checksum = fnv1a(FNV1A_INIT, body, body_size);
+}
+
+// Function to write an image to an object file
+int object_write(const sim_image_t *image, const char *name, const char *file_path)
+{
+    size_t name_size = strlen(name);
+    if (name_size > UINT16_MAX)
+        name_size = UINT16_MAX;
+
+    size_t size = object_size(image, name_size);
+    uint8_t *buffer = (uint8_t *)malloc(size);
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate memory for object file\n");
+        return 0;
+    }
+    object_encode(image, name, name_size, buffer);
+
+    FILE *file = fopen(file_path, "wb");
+    int ok = file != NULL && fwrite(buffer, size, 1, file) == 1;
+    if (file != NULL && fclose(file) != 0)
+        ok = 0;
+    free(buffer);
+
+    if (!ok)
+    {
+        fprintf(stderr, "Error: Failed to write object file: %s\n", file_path);
+        return 0;
+    }
+    return 1;
+}
+
+// Function to decode an object held in memory into an image
+uint16_t object_read(sim_image_t *image, const void *data, size_t size, const char *source)
+{
+    const object_header_t *header = (const object_header_t *)data;
+    const uint8_t *body = (const uint8_t *)data + sizeof(object_header_t);
+    const char *problem = NULL;
+
+    if (size < sizeof(object_header_t) || memcmp(header->magic, OBJECT_MAGIC, sizeof(header->magic)) != 0)
+        problem = "not an object file";
+    else if (header->byte_order != OBJECT_BYTE_ORDER)
+        problem = "assembled on a host with a different byte order";
+    else if (header->version != OBJECT_VERSION || header->header_size != sizeof(object_header_t))
+        problem = "unsupported version";
+    else if (header->instr_count == 0 || header->instr_count > INSTR_MEMORY_SIZE ||
+             header->data_count > IMAGE_DATA_SIZE)
+        problem = "program does not fit the machine";
+
+    size_t body_size = 0;
+    if (problem == NULL)
+    {
+        body_size = header->data_count * sizeof(object_data_t) +
+                    header->instr_count * sizeof(instruction_word_t) + header->name_size;
+        if (size < sizeof(object_header_t) + body_size)
+            problem = "truncated";
+        else if (header->checksum != fnv1a(FNV1A_INIT, body, body_size))
+            problem = "checksum mismatch";
+    }
+
+    const object_data_t *records = (const object_data_t *)body;
+    for (uint16_t i = 0; problem == NULL && i < header->data_count; i++)
+    {
+        if (records[i].address >= IMAGE_DATA_SIZE)
+            problem = "data initializer out of range";
+    }
+
+    if (problem != NULL)
+    {
+        fprintf(stderr, "Error: Cannot load object %s: %s\n", source, problem);
+        return 0;
+    }
+
+    // Object sections are 2-byte aligned within the file, and archives
+    // keep every object 8-byte aligned
+    const instruction_word_t *words =
+        (const instruction_word_t *)(body + header->data_count * sizeof(object_data_t));
+    sim_image_from_words(image, words, header->instr_count);
+    for (uint16_t i = 0; i < header->data_count; i++)
+    {
+        if (image->data[records[i].address] == 0 && records[i].value != 0)
+            image->data_count++;
+        image->data[records[i].address] = records[i].value;
+    }
+    return image->count;
+}
+
+// Function to check whether a file starts with the object magic
+int object_is_file(const char *file_path)
+{
+    char magic[8] = {0};
+    FILE *file = fopen(file_path, "rb");
+    if (!file)
+        return 0;
+    size_t read = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    return read == sizeof(magic) && memcmp(magic, OBJECT_MAGIC, sizeof(magic)) == 0;
+}
+
+// Function to map an object file and decode it into an image
+uint16_t object_load_file(sim_image_t *image, const char *file_path)
+{
+    size_t size = 0;
+    const uint8_t *data = map_file(file_path, &size);
+    if (data == NULL)
+    {
+        fprintf(stderr, "Error: Failed to open object file: %s\n", file_path);
+        return 0;
+    }
+
+    uint16_t count = object_read(image, data, size, file_path);
+    unmap_file(data, size);
+    return count;
+}
+
+// Archive being written: objects stream to the file, the index and the
+// name table grow in memory until the end
+typedef struct
+{
+    FILE *file;
+    uint64_t offset; // Where the next object goes
+    archive_entry_t *entries;
+    uint32_t count;
+    uint32_t capacity;
+    char *names;
+    size_t names_size;
+    size_t names_capacity;
+    uint8_t *buffer; // Encoding space for one object
+    size_t buffer_size;
+} packer_t;
+
+static const uint8_t padding[ARCHIVE_ALIGN] = {0};
+
+// Helper function to append one image to the archive under name
+static int pack_image(packer_t *packer, const sim_image_t *image, const char *name, size_t name_size)
+{
+    if (name_size > UINT16_MAX)
+        name_size = UINT16_MAX;
+
+    size_t size = object_size(image, name_size);
+    if (packer->count == packer->capacity || packer->names_size + name_size + 1 > packer->names_capacity ||
+        size > packer->buffer_size)
+    {
+        packer->capacity = packer->capacity ? packer->capacity * 2 : 1024;
+        while (packer->names_size + name_size + 1 > packer->names_capacity)
+            packer->names_capacity = packer->names_capacity ? packer->names_capacity * 2 : 16384;
+        if (size > packer->buffer_size)
+            packer->buffer_size = size;
+        packer->entries = (archive_entry_t *)realloc(packer->entries, packer->capacity * sizeof(archive_entry_t));
+        packer->names = (char *)realloc(packer->names, packer->names_capacity);
+        packer->buffer = (uint8_t *)realloc(packer->buffer, packer->buffer_size);
+        if (packer->entries == NULL || packer->names == NULL || packer->buffer == NULL)
+        {
+            fprintf(stderr, "Error: Failed to allocate memory for archive\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    object_encode(image, name, name_size, packer->buffer);
+
+    size_t pad = (size_t)(-packer->offset & (ARCHIVE_ALIGN - 1));
+    if (fwrite(padding, 1, pad, packer->file) != pad || fwrite(packer->buffer, size, 1, packer->file) != 1)
+        return 0;
+    packer->offset += pad;
+
+    archive_entry_t *entry = &packer->entries[packer->count++];
+    entry->offset = packer->offset;
+    entry->size = (uint32_t)size;
+    entry->name_offset = (uint32_t)packer->names_size;
+    memcpy(packer->names + packer->names_size, name, name_size);
+    packer->names[packer->names_size + name_size] = '\0';
+    packer->names_size += name_size + 1;
+    packer->offset += size;
+    return 1;
+}
+
+// Helper function to assemble every program of a text file into the
+// archive; programs without a .program name are stored under the path.
+// Returns the number of errors and adds the lines scanned to *lines
+static int pack_text(packer_t *packer, sim_image_t *image, const char *path, long long *lines, int *write_failed)
+{
+    size_t size = 0;
+    const uint8_t *text = map_file(path, &size);
+    if (text == NULL)
+    {
+        fprintf(stderr, "Error: Could not load program '%s'\n", path);
+        return 1;
+    }
+
+    asm_program_t program;
+    asm_scanner_t scanner;
+    asm_error_t error;
+    asm_status_t status;
+    int errors = 0;
+
+    asm_init(&scanner, (const char *)text, size);
+    while (!*write_failed && (status = asm_next_program(&scanner, &program, &error)) != ASM_END)
+    {
+        if (status == ASM_ERROR)
+        {
+            fprintf(stderr, "Error: %s:%d: %s\n", path, error.line, error.message);
+            errors++;
+            continue;
+        }
+
+        sim_image_from_words(image, program.words, program.count);
+        if (program.name != NULL && program.name_size > 0)
+            *write_failed = !pack_image(packer, image, program.name, program.name_size);
+        else
+            *write_failed = !pack_image(packer, image, path, strlen(path));
+    }
+
+    *lines += scanner.line - 1;
+    unmap_file(text, size);
+    return errors;
+}
+
+// Helper function to order archive entries by name for qsort
+static const char *sort_names;
+static int compare_entries(const void *a, const void *b)
+{
+    const archive_entry_t *left = (const archive_entry_t *)a;
+    const archive_entry_t *right = (const archive_entry_t *)b;
+    return strcmp(sort_names + left->name_offset, sort_names + right->name_offset);
+}
+
+// Function to pack programs into an archive
+int archive_create(const char *file_path, const char *const *programs, int count)
+{
+    sim_image_t *image = (sim_image_t *)malloc(sizeof(sim_image_t));
+    if (image == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate memory for archive\n");
+        exit(EXIT_FAILURE);
+    }
+
+    packer_t packer = {0};
+    packer.file = fopen(file_path, "wb");
+    if (packer.file == NULL)
+    {
+        fprintf(stderr, "Error: Failed to create archive: %s\n", file_path);
+        free(image);
+        return 0;
+    }
+
+    // Objects first, right after a header that is rewritten at the end
+    archive_header_t header = {0};
+    packer.offset = sizeof(archive_header_t);
+    int write_failed = fwrite(&header, sizeof(header), 1, packer.file) != 1;
+    int errors = 0;
+    long long lines = 0;
+    struct timespec start_time, end_time;
+    timespec_get(&start_time, TIME_UTC);
+
+    for (int i = 0; !write_failed && i < count; i++)
+    {
+        if (object_is_file(programs[i]))
+        {
+            if (object_load_file(image, programs[i]) == 0)
+                errors++;
+            else
+                write_failed = !pack_image(&packer, image, programs[i], strlen(programs[i]));
+        }
+        else
+        {
+            errors += pack_text(&packer, image, programs[i], &lines, &write_failed);
+        }
+    }
+
+    timespec_get(&end_time, TIME_UTC);
+    double seconds = (end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+
+    sort_names = packer.names;
+    if (packer.count > 0)
+        qsort(packer.entries, packer.count, sizeof(archive_entry_t), compare_entries);
+    for (uint32_t i = 1; i < packer.count; i++)
+    {
+        if (strcmp(packer.names + packer.entries[i - 1].name_offset, packer.names + packer.entries[i].name_offset) == 0)
+        {
+            fprintf(stderr, "Error: Program '%s' is packed twice\n", packer.names + packer.entries[i].name_offset);
+            errors++;
+        }
+    }
+
+    if (!write_failed)
+    {
+        size_t pad = (size_t)(-packer.offset & (ARCHIVE_ALIGN - 1));
+        memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+        header.version = ARCHIVE_VERSION;
+        header.byte_order = OBJECT_BYTE_ORDER;
+        header.header_size = sizeof(archive_header_t);
+        header.entry_count = packer.count;
+        header.index_offset = packer.offset + pad;
+        header.names_offset = header.index_offset + packer.count * sizeof(archive_entry_t);
+        header.names_size = packer.names_size;
+        write_failed = fwrite(padding, 1, pad, packer.file) != pad ||
+                       fwrite(packer.entries, sizeof(archive_entry_t), packer.count, packer.file) != packer.count ||
+                       fwrite(packer.names, 1, packer.names_size, packer.file) != packer.names_size ||
+                       fseek(packer.file, 0, SEEK_SET) != 0 ||
+                       fwrite(&header, sizeof(header), 1, packer.file) != 1;
+    }
+    if (fclose(packer.file) != 0)
+        write_failed = 1;
+    if (write_failed)
+        fprintf(stderr, "Error: Failed to write archive: %s\n", file_path);
+
+    log_summary("Packed %u program(s) into %s, %d error(s)\n", packer.count, file_path, errors);
+    if (lines > 0)
+        log_summary("Assembled %lld lines in %.3f s (%.0f lines/s)\n",
+                    lines, seconds, seconds > 0 ? lines / seconds : 0.0);
+
+    free(packer.buffer);
+    free(packer.names);
+    free(packer.entries);
+    free(image);
+    return !write_failed && errors == 0;
+}
+
+// Function to map an archive and check its index
+archive_t *archive_open(const char *file_path)
+{
+    size_t size = 0;
+    const uint8_t *data = map_file(file_path, &size);
+    if (data == NULL)
+    {
+        fprintf(stderr, "Error: Failed to open archive: %s\n", file_path);
+        return NULL;
+    }
+
+    const archive_header_t *header = (const archive_header_t *)data;
+    const char *problem = NULL;
+    if (size < sizeof(archive_header_t) || memcmp(header->magic, ARCHIVE_MAGIC, sizeof(header->magic)) != 0)
+        problem = "not an archive";
+    else if (header->byte_order != OBJECT_BYTE_ORDER)
+        problem = "packed on a host with a different byte order";
+    else if (header->version != ARCHIVE_VERSION || header->header_size != sizeof(archive_header_t))
+        problem = "unsupported version";
+    // Offsets are untrusted 64-bit values, so every range is checked by
+    // subtraction from its limit, which cannot wrap
+    else if (header->index_offset % ARCHIVE_ALIGN != 0 || header->index_offset < sizeof(archive_header_t) ||
+             header->names_size > size || header->names_offset > size - header->names_size ||
+             header->index_offset > header->names_offset ||
+             (uint64_t)header->entry_count * sizeof(archive_entry_t) > header->names_offset - header->index_offset ||
+             (header->names_size > 0 && data[header->names_offset + header->names_size - 1] != '\0'))
+        problem = "corrupt index";
+
+    const archive_entry_t *entries = (const archive_entry_t *)(data + (problem ? 0 : header->index_offset));
+    for (uint32_t i = 0; problem == NULL && i < header->entry_count; i++)
+    {
+        if (entries[i].offset % ARCHIVE_ALIGN != 0 || entries[i].size > header->index_offset ||
+            entries[i].offset > header->index_offset - entries[i].size || entries[i].name_offset >= header->names_size)
+            problem = "corrupt index";
+    }
+
+    archive_t *archive = problem ? NULL : (archive_t *)malloc(sizeof(archive_t));
+    if (archive == NULL)
+    {
+        fprintf(stderr, "Error: Cannot open archive %s: %s\n", file_path,
+                problem ? problem : "out of memory");
+        unmap_file(data, size);
+        return NULL;
+    }
+
+    archive->data = data;
+    archive->size = size;
+    archive->entries = entries;
+    archive->names = (const char *)data + header->names_offset;
+    archive->count = header->entry_count;
+    return archive;
+}
+
+// Function to unmap and free an archive
+void archive_close(archive_t *archive)
+{
+    if (archive == NULL)
+        return;
+    unmap_file(archive->data, archive->size);
+    free(archive);
+}
+
+int archive_count(const archive_t *archive)
+{
+    return (int)archive->count;
+}
+
+const char *archive_name(const archive_t *archive, int index)
+{
+    return archive->names + archive->entries[index].name_offset;
+}
+
+// Function to find a program by name (binary search of the sorted index)
+int archive_find(const archive_t *archive, const char *name)
+{
+    int low = 0;
+    int high = (int)archive->count - 1;
+    while (low <= high)
+    {
+        int middle = low + (high - low) / 2;
+        int order = strcmp(archive_name(archive, middle), name);
+        if (order == 0)
+            return middle;
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle - 1;
+    }
+    return -1;
+}
+
+// Function to decode one program of an archive into an image
+uint16_t archive_load(const archive_t *archive, int index, sim_image_t *image)
+{
+    const archive_entry_t *entry = &archive->entries[index];
+    return object_read(image, archive->data + entry->offset, entry->size, archive_name(archive, index));
+}
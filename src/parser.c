@@ -1,7 +1,7 @@
-#include "globals.h"
 #include "parser.h"
 #include <ctype.h> // for isspace()
 #include <stdio.h> // for printf
+#include "log.h"
 
 // Helper function to get the opcode enum value from the mnemonic
 static Opcode get_opcode_from_mnemonic(const char *mnemonic)
@@ -13,7 +13,7 @@ static Opcode get_opcode_from_mnemonic(const char *mnemonic)
         fprintf(stderr, "[PARSER] Unknown mnemonic: %s\n", mnemonic);
         exit(EXIT_FAILURE);
     }
-    fprintf(stderr, "[PARSER]   Opcode: %d\n", opcode);
+    log_debug("[PARSER]   Opcode: %d\n", opcode);
     return opcode;
 }
 
@@ -67,7 +67,7 @@ static instruction_word_t parse_instruction_line(const char *line)
     char mnemonic[10];
     char operands[50];
 
-    printf("[PARSER]   Parsing line: \"%s\"\n", line); // Debug: show input line
+    log_debug("[PARSER]   Parsing line: \"%s\"\n", line); // Debug: show input line
 
     // Split line into mnemonic and operands
     char *space = strchr(line, ' ');
@@ -85,7 +85,7 @@ static instruction_word_t parse_instruction_line(const char *line)
     // Extract operands
     strcpy(operands, space + 1);
 
-    printf("[PARSER]   Mnemonic: %s, Operands: %s\n", mnemonic, operands); // Debug
+    log_debug("[PARSER]   Mnemonic: %s, Operands: %s\n", mnemonic, operands); // Debug
 
     // Get the opcode
     instr.opcode = get_opcode_from_mnemonic(mnemonic);
@@ -119,12 +119,12 @@ static instruction_word_t parse_instruction_line(const char *line)
     instr.operand_2 = extract_register_number_or_immediate(operand_list[1]);
 
     uint16_t binary = instruction_to_binary(&instr);
-    printf("[PARSER]   HEX: 0x%04X\n\n", binary); // Debug: show binary representation
+    log_debug("[PARSER]   HEX: 0x%04X\n\n", binary); // Debug: show binary representation
 
     return binary;
 }
 
-uint16_t parse_and_load_assembly_file(const char *file_path)
+uint16_t parse_and_load_assembly_file(machine_t *m, const char *file_path)
 {
     FILE *file = fopen(file_path, "r");
     if (!file)
@@ -137,7 +137,7 @@ uint16_t parse_and_load_assembly_file(const char *file_path)
     uint16_t address = 0;
     char line[256];
 
-    printf("[PARSER]   Loading assembly from: %s\n", file_path); // Debug
+    log_summary("[PARSER]   Loading assembly from: %s\n", file_path); // Debug
 
     while (fgets(line, sizeof(line), file) && address < INSTR_MEMORY_SIZE)
     {
@@ -146,15 +146,16 @@ uint16_t parse_and_load_assembly_file(const char *file_path)
             continue; // Skip empty lines
 
         uint16_t current_instruction = parse_instruction_line(line);
-        write_instruction(address++, current_instruction);
+        write_instruction(m, address, current_instruction);
+        read_decoded_instruction(m, address++); // Fill the pre-decoded copy up front
     }
 
     fclose(file);
-    printf("[PARSER] Successfully finished loading %d instructions into memory.\n", address); // Debug summary
+    log_summary("[PARSER] Successfully finished loading %d instructions into memory.\n", address); // Debug summary
     return address;
 }
 
 void print_instruction_binary(const uint16_t binary)
 {
-    printf("[PARSER]   Binary: 0x%04X\n", binary);
+    log_debug("[PARSER]   Binary: 0x%04X\n", binary);
 }
\ No newline at end of file
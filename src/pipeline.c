@@ -1,179 +1,468 @@
 #include "pipeline.h"
+#include <string.h>
+#include <limits.h>
+#include "log.h"
+#include "flags.h"
+#include "instructions.h" // access_data_cache
 
-int cycle = 1; // Cycle counter
-int decode_stall = 0;
-int execute_stall = 0;
-int stop = 0;         // Stop flag
-struct EXEC EX = {0}; // Definition of the global EX variable
+void fetch_stage(machine_t *m);
+void execute_stage(machine_t *m);
+void opcode_func(machine_t *m, ID_EX *id_ex);
 
-void fetch_stage();
-void execute_stage();
-void opcode_func(Opcode opcode);
+// Helper function to trace the register or data memory write of an
+// instruction execute has just run
+static void trace_result(machine_t *m, const ID_EX *id_ex)
+{
+    if (isa_table[id_ex->opcode & 0xF].operands & ISA_WRITES_R1)
+        trace_event(m->trace, TRACE_REGISTER, 0, m->cycle, id_ex->pc - 1, id_ex->instruction, id_ex->r1,
+                    m->register_file[id_ex->r1]);
+    else if (id_ex->opcode == STR)
+        trace_event(m->trace, TRACE_MEMORY, 0, m->cycle, id_ex->pc - 1, id_ex->instruction,
+                    (uint8_t)id_ex->immediate, m->EX.result);
+}
+
+// Function to put the pipeline back into its power-on state
+void reset_pipeline(machine_t *m)
+{
+    m->cycle = 1;
+    m->decode_stall = 0;
+    m->execute_stall = 0;
+    m->stop = 0;
+    m->sys_call = 1;
+    m->fault = FAULT_NONE;
+    m->fetch_ready_cycle = 0;
+    m->memory_stall = 0;
+    m->EX.result = 0;
+    m->PC = 0;
+    init_queue(&m->if_id_queue);
+    init_queue(&m->id_ex_queue);
+    init_queue(&m->ex_mem_queue);
+    init_queue(&m->mem_wb_queue);
+    scoreboard_reset(&m->scoreboard);
+    predictor_reset(&m->predictor);
+    cache_reset(&m->icache);
+    cache_reset(&m->dcache);
+    memset(&m->counters, 0, sizeof(m->counters));
+}
+
+// Helper function to run the write-back and memory stages of the 5-stage
+// pipeline: WB retires the group in MEM/WB, then MEM moves the group in
+// EX/MEM on, running its load or store through the D-cache model. Execute
+// has already applied every instruction's effects, so these stages only
+// add their timing (the bypass timing is the scoreboard's, scoreboard.h).
+static void memory_writeback_stages(machine_t *m)
+{
+    while (!isEmpty(&m->mem_wb_queue))
+    {
+        const ID_EX *id_ex = dequeue_id_ex(&m->mem_wb_queue);
+        log_stage("Write Back Stage: Instruction: 0x%04X, Opcode: %s, PC: %d\n", id_ex->instruction,
+                  get_opcode_mnemonic(id_ex->opcode), id_ex->pc);
+    }
+
+    while (!isEmpty(&m->ex_mem_queue))
+    {
+        ID_EX *id_ex = dequeue_id_ex(&m->ex_mem_queue);
+        log_stage("Memory Stage: Instruction: 0x%04X, Opcode: %s, PC: %d\n", id_ex->instruction,
+                  get_opcode_mnemonic(id_ex->opcode), id_ex->pc);
+        if (id_ex->opcode == LDR || id_ex->opcode == STR)
+            access_data_cache(m, (uint8_t)id_ex->immediate, id_ex->opcode == STR);
+        enqueue_id_ex(&m->mem_wb_queue, id_ex);
+    }
+}
+
+// Helper function to check whether every latch is empty
+static int pipeline_empty(machine_t *m)
+{
+    return isEmpty(&m->if_id_queue) && isEmpty(&m->id_ex_queue) && isEmpty(&m->ex_mem_queue) &&
+           isEmpty(&m->mem_wb_queue);
+}
 
-void pipeline_cycle()
+void pipeline_cycle(machine_t *m)
 {
-    printf("\nCycle %d\n", cycle);
-    fetch_stage();
+    log_stage("\nCycle %d\n", m->cycle);
+    m->counters.cycles++;
 
-    if (decode_stall > 0)
+    // A D-cache miss holds every stage until memory answers (cache.h)
+    if (m->memory_stall > 0)
     {
-        printf("Stalling decode stage (%d cycles left)\n", decode_stall);
-        decode_stall--;
+        log_stage("Pipeline Stalled: waiting on the data cache (%d cycles left)\n", m->memory_stall);
+        if (m->trace != NULL)
+            trace_event(m->trace, TRACE_STALL, TRACE_STALL_DCACHE, m->cycle, 0, 0, 0, (int16_t)m->memory_stall);
+        if (m->hooks.active & HOOK_BIT(HOOK_STALL))
+            hooks_stall(m, TRACE_STALL_DCACHE, m->memory_stall, 0, 0);
+        m->memory_stall--;
+        m->counters.dcache.stall_cycles++;
+        m->cycle++;
+        return;
     }
-    else if (PC > 1)
+
+    fetch_stage(m);
+
+    uint32_t decoded = m->id_ex_queue.count; // Decoded before this cycle, so execute's next group
+    if (m->decode_stall > 0)
     {
-        if (stop >= 2)
+        log_stage("Stalling decode stage (%d cycles left)\n", m->decode_stall);
+        if (m->trace != NULL)
+            trace_event(m->trace, TRACE_STALL, TRACE_STALL_DECODE, m->cycle, 0, 0, 0, (int16_t)m->decode_stall);
+        if (m->hooks.active & HOOK_BIT(HOOK_STALL))
+            hooks_stall(m, TRACE_STALL_DECODE, m->decode_stall, 0, 0);
+        m->decode_stall--;
+        m->counters.decode_stall_cycles++;
+    }
+    else if (m->cycle > 1) // Fill: decode starts in cycle 2 (not keyed on PC, which predicted branches move back)
+    {
+        if (m->stop >= 2 && isEmpty(&m->if_id_queue))
         {
-            printf("Decode Stage: Stopped\n");
+            log_stage("Decode Stage: Stopped\n");
         }
+        else if (m->if_id_queue.count == 1 && m->cycle < m->fetch_ready_cycle)
+            log_stage("Decode Stage: Waiting on the instruction cache\n"); // Only the newest fetch can be in flight
         else
-            decode_stage();
+            decode_stage(m);
     }
 
-    if (execute_stall > 0)
+    // MEM and WB go after decode, like execute, so a D-cache miss in MEM
+    // pushes back what decode issued this cycle (scoreboard_delay)
+    if (m->stages > 3)
+        memory_writeback_stages(m);
+
+    if (m->execute_stall > 0)
     {
-        printf("Stalling execute stage (%d cycles left)\n", execute_stall);
-        execute_stall--;
+        log_stage("Stalling execute stage (%d cycles left)\n", m->execute_stall);
+        if (m->trace != NULL)
+            trace_event(m->trace, TRACE_STALL, TRACE_STALL_EXECUTE, m->cycle, 0, 0, 0, (int16_t)m->execute_stall);
+        if (m->hooks.active & HOOK_BIT(HOOK_STALL))
+            hooks_stall(m, TRACE_STALL_EXECUTE, m->execute_stall, 0, 0);
+        m->execute_stall--;
+        m->counters.execute_stall_cycles++;
     }
-    else if (PC > 2)
+    else if (m->cycle > 2) // and execute in cycle 3
     {
-        if (stop >= 3)
+        // The last instruction has left the pipeline once fetch has found
+        // nothing for as many cycles as there are stages
+        if (m->stop >= m->stages && pipeline_empty(m))
         {
-            printf("Execute Stage: Stopped\n");
-            sys_call = 0;
+            log_stage("Execute Stage: Stopped\n");
+            m->sys_call = 0;
+            if (m->PC >= INSTR_MEMORY_SIZE)
+                raise_fault(m, FAULT_INSTRUCTION_READ, m->PC); // The program itself ran off instruction memory
             return;
         }
+        else if (isEmpty(&m->id_ex_queue))
+            log_stage("Execute Stage: Bubble\n"); // Decode stalled on a data hazard
+        else if (m->issue_width == 1)
+            execute_stage(m);
         else
-            execute_stage();
+        {
+            // Without an older group, execute takes the one decode issued
+            // this cycle after waiting on the I-cache
+            uint32_t group = decoded > 0 ? decoded : m->id_ex_queue.count;
+            if (group > (uint32_t)m->issue_width)
+                group = (uint32_t)m->issue_width;
+            for (uint32_t slot = 0; slot < group && !isEmpty(&m->id_ex_queue); slot++) // A flush empties the latch
+                execute_stage(m);
+        }
     }
 
-    cycle++;
+    m->cycle++;
 }
 
-void fetch_stage()
+// Helper function to count the cycles, starting with the current one, in
+// which no stage has work: fetch waits on the I-cache or has run past the
+// end of the program, and decode and execute are stalled, waiting or empty.
+// Nothing enters or leaves a latch in such cycles, so whether each stage is
+// idle only depends on counters that run down (or, past the end, up) one
+// per cycle, and each condition below holds for a prefix of the cycles
+// ahead. Mirrors the checks of pipeline_cycle and fetch_stage.
+static int idle_cycles(machine_t *m)
 {
-    // Store the PC value at the start of fetch
-    instruction_word_t fetch_pc = PC;
+    int cycle = m->cycle;
+    int fetch_waiting = cycle < m->fetch_ready_cycle;
+    if (m->if_id_queue.count >= 2 ||
+        (!fetch_waiting && m->PC < INSTR_MEMORY_SIZE && m->instr_memory[m->PC] != UNDEFINED_INT16))
+        return 0; // Fetch has work (or decode is stalled on a data hazard)
+    if (!isEmpty(&m->ex_mem_queue) || !isEmpty(&m->mem_wb_queue))
+        return 0; // MEM or WB has work
 
-    // Fetch stage
-    instruction_word_t instruction = read_instruction(PC);
-    if (instruction == UNDEFINED_INT16)
+    // Past the end of the program fetch counts stop up before the other
+    // stages look at it, so in the n-th idle cycle they see stop + n
+    int stop = m->stop + !fetch_waiting;
+    int fetch = fetch_waiting ? m->fetch_ready_cycle - cycle : INT_MAX;
+
+    // Decode idles through its bubble, the fill and the I-cache wait of its
+    // only entry, whatever the drain has reached
+    int decode = INT_MAX;
+    if (!isEmpty(&m->if_id_queue))
     {
-        stop++;
-        printf("Fetch Stage: Stopped\n");
-        return;
+        decode = m->decode_stall > 2 - cycle ? m->decode_stall : 2 - cycle;
+        if (fetch_waiting && fetch > decode)
+            decode = fetch; // Waiting on the I-cache with fetch
+        if (decode < 0)
+            decode = 0;
     }
 
-    printf("Fetch Stage: PC: %d, Instruction: 0x%04X\n", PC, instruction);
-    IF_ID if_id = {0}; // Instruction Fetch to Decode stage
-    if_id.instr = instruction;
-    if_id.pc = ++PC;
+    // Execute idles through its bubble and the fill, and after that only
+    // if its latch is empty and the drain has not finished (which needs
+    // IF/ID to be empty too, and one cycle of stop per stage)
+    int execute = m->execute_stall > 3 - cycle ? m->execute_stall : 3 - cycle;
+    if (execute < 0)
+        execute = 0;
+    if (isEmpty(&m->id_ex_queue))
+    {
+        int end = INT_MAX;
+        if (isEmpty(&m->if_id_queue))
+            end = fetch_waiting ? (stop >= m->stages ? 0 : INT_MAX) : m->stages - stop;
+        if (end > execute)
+            execute = end;
+    }
 
-    // Show the input values (PC) and output (the instruction and next PC)
-    printf("  Input: PC = %d\n", fetch_pc);
-    printf("  Output: Fetched instruction = 0x%04X, Next PC = %d\n", instruction, PC);
+    int idle = fetch < decode ? fetch : decode;
+    return idle < execute ? idle : execute;
+}
+
+// Helper function to jump over the idle cycles from the current one, but
+// not past cycle limit (0: no limit), with the counters and state that
+// running them would leave; returns the number of cycles skipped
+static long long skip_idle_cycles(machine_t *m, long long limit)
+{
+    long long room = limit > 0 ? limit - m->cycle + 1 : LLONG_MAX;
+    long long skipped = 0;
+
+    // A D-cache miss freezes every stage, so the whole wait is idle
+    if (m->memory_stall > 0)
+    {
+        int cycles = room < m->memory_stall ? (int)room : m->memory_stall;
+        m->memory_stall -= cycles;
+        m->counters.dcache.stall_cycles += cycles;
+        m->counters.cycles += cycles;
+        m->cycle += cycles;
+        skipped = cycles;
+        room -= cycles;
+        if (m->memory_stall > 0 || room == 0)
+            return skipped;
+    }
 
-    enqueue_if_id(&if_id_queue, &if_id);
-    printf("To be decoded ");
-    print_queue(&if_id_queue); // Print the queue after processing
+    long long cycles = idle_cycles(m);
+    if (cycles > room)
+        cycles = room;
+
+    int decode = m->decode_stall < cycles ? m->decode_stall : (int)cycles;
+    int execute = m->execute_stall < cycles ? m->execute_stall : (int)cycles;
+    m->decode_stall -= decode;
+    m->counters.decode_stall_cycles += decode;
+    m->execute_stall -= execute;
+    m->counters.execute_stall_cycles += execute;
+    if (m->cycle < m->fetch_ready_cycle)
+        m->counters.icache.stall_cycles += cycles;
+    else
+        m->stop += (int)cycles;
+    m->counters.cycles += cycles;
+    m->cycle += (int)cycles;
+    return skipped + cycles;
 }
 
-void execute_stage()
+// Function to skip the idle cycles ahead, or run the cycle if there are none
+long long pipeline_skip(machine_t *m, long long limit)
 {
+    // Observers see every cycle, so only unobserved runs skip
+    if ((m->memory_stall > 0 || idle_cycles(m) > 0) && m->trace == NULL && m->hooks.active == 0 &&
+        !TRACE_ENABLED(LOG_STAGE))
+        return skip_idle_cycles(m, limit);
 
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue)); // Decode to Execute stage
+    pipeline_cycle(m);
+    return 1;
+}
 
-    // Print the instruction entering the execute stage
-    printf("Execute Stage: Instruction: 0x%04X, Opcode: %s, PC: %d\n",
-           id_ex.instruction,
-           get_opcode_mnemonic(id_ex.opcode),
-           id_ex.pc);
+// Helper function to fetch the instruction at PC into the given slot of
+// this cycle's fetch group; returns 1 if fetch can go on with the next slot
+static int fetch_instruction(machine_t *m, int slot)
+{
+    // Store the PC value at the start of fetch
+    instruction_word_t fetch_pc = m->PC;
 
-    // Store register values before execution for comparison
-    data_word_t old_register_values[REG_COUNT];
-    for (int i = 0; i < REG_COUNT; i++)
+    // Decode normally leaves at most one group behind; a second means it is
+    // stalled on a data hazard and fetch waits too
+    if (m->if_id_queue.count >= 2 * (uint32_t)m->issue_width)
     {
-        old_register_values[i] = read_register(i);
+        if (slot == 0)
+            log_stage("Fetch Stage: Stalled\n");
+        return 0;
     }
 
-    // Store the SREG value before execution
-    data_word_t old_SREG = SREG;
-
-    // Store PC before execution
-    instruction_word_t old_PC = PC;
-
-    // Execute the instruction
-    opcode_func(id_ex.opcode);
+    // Fetch blocks while its last instruction is still coming from memory
+    if (m->cycle < m->fetch_ready_cycle)
+    {
+        log_stage("Fetch Stage: Waiting on the instruction cache (%d cycles left)\n", m->fetch_ready_cycle - m->cycle);
+        m->counters.icache.stall_cycles++;
+        if (m->trace != NULL)
+            trace_event(m->trace, TRACE_STALL, TRACE_STALL_ICACHE, m->cycle, 0, 0, 0,
+                        (int16_t)(m->fetch_ready_cycle - m->cycle));
+        if (m->hooks.active & HOOK_BIT(HOOK_STALL))
+            hooks_stall(m, TRACE_STALL_ICACHE, m->fetch_ready_cycle - m->cycle, 0, 0);
+        return 0;
+    }
 
-    // Check for changes in registers
-    for (int i = 0; i < REG_COUNT; i++)
+    // Fetch stage. Past the end of instruction memory it finds nothing, as
+    // past the end of the program: a wrong-path fetch there is flushed, and
+    // the drain raises the fault if the program really went there
+    instruction_word_t instruction = m->PC < INSTR_MEMORY_SIZE ? m->instr_memory[m->PC] : UNDEFINED_INT16;
+    if (instruction == UNDEFINED_INT16)
     {
-        if (read_register(i) != old_register_values[i])
+        // The drain counts the cycles in which fetch has nothing at all
+        if (slot == 0)
         {
-            printf("  Register Change in Execute Stage: R%d changed from %d to %d\n",
-                   i, old_register_values[i], read_register(i));
+            m->stop++;
+            log_stage("Fetch Stage: Stopped\n");
         }
+        return 0;
     }
 
-    // Check for changes in SREG
-    if (SREG != old_SREG)
+    log_stage("Fetch Stage: PC: %d, Instruction: 0x%04X\n", m->PC, instruction);
+    int latency = cache_access(&m->icache, &m->counters.icache, (uint32_t)fetch_pc * INSTRUCTION_BYTES, 0);
+    if (latency > 0)
     {
-        printf("  SREG Change in Execute Stage: Changed from 0x%02X to 0x%02X\n",
-               old_SREG, SREG);
+        m->fetch_ready_cycle = m->cycle + 1 + latency;
+        log_stage("  I-cache miss: decode gets the instruction in %d extra cycles\n", latency);
     }
+    IF_ID if_id = {0}; // Instruction Fetch to Decode stage
+    if_id.instr = instruction;
+    if_id.pc = ++m->PC;
 
-    // Check for changes in PC (for branch instructions)
-    if (PC != old_PC)
+    // Fetch follows the branch predictor (predictor.h)
+    Opcode opcode = (Opcode)(instruction >> 12);
+    if ((opcode == BEQZ || opcode == BR) &&
+        predict_branch(&m->predictor, fetch_pc, read_decoded_instruction(m, fetch_pc), &if_id.predicted_pc))
     {
-        printf("  PC Change in Execute Stage: Changed from %d to %d\n",
-               old_PC, PC);
+        if_id.predicted_taken = 1;
+        m->PC = if_id.predicted_pc;
+        log_stage("  Predicted taken: next fetch from PC = %d\n", m->PC);
     }
-    if (!isEmpty(&id_ex_queue))
-        dequeue_id_ex(&id_ex_queue);
+
+    // Show the input values (PC) and output (the instruction and next PC)
+    log_stage("  Input: PC = %d\n", fetch_pc);
+    log_stage("  Output: Fetched instruction = 0x%04X, Next PC = %d\n", instruction, m->PC);
+
+    enqueue_if_id(&m->if_id_queue, &if_id);
+    if (m->trace != NULL)
+        trace_event(m->trace, TRACE_FETCH, if_id.predicted_taken ? TRACE_PREDICTED_TAKEN : 0, m->cycle, fetch_pc,
+                    instruction, m->PC, 0);
+    log_stage("To be decoded ");
+    if (TRACE_ENABLED(LOG_STAGE))
+        print_queue(&m->if_id_queue); // Print the queue after processing
+
+    // A miss or a predicted-taken branch ends the group
+    return latency == 0 && !if_id.predicted_taken;
 }
 
-void opcode_func(Opcode opcode)
+// Function to fetch up to the issue width of consecutive instructions
+void fetch_stage(machine_t *m)
 {
-    ID_EX id_ex = *(peek_id_ex(&id_ex_queue)); // Decode to Execute stage
-    switch (opcode)
+    int slot = 0;
+    while (fetch_instruction(m, slot) && ++slot < m->issue_width)
+        ;
+}
+
+void execute_stage(machine_t *m)
+{
+
+    ID_EX *id_ex = peek_id_ex(&m->id_ex_queue); // Decode to Execute stage, executed in place
+    m->counters.retired++;
+    m->EX.pc = id_ex->pc;
+    m->EX.instruction = id_ex->instruction;
+    m->counters.opcode_retired[id_ex->opcode & 0xF]++;
+    scoreboard_forward(&m->scoreboard, id_ex);
+    if (m->stages > 3)
+        enqueue_id_ex(&m->ex_mem_queue, id_ex); // Copied before a flush can empty the latch
+
+    // Print the instruction entering the execute stage
+    log_stage("Execute Stage: Instruction: 0x%04X, Opcode: %s, PC: %d\n",
+           id_ex->instruction,
+           get_opcode_mnemonic(id_ex->opcode),
+           id_ex->pc);
+
+    if (m->trace != NULL)
+        trace_event(m->trace, TRACE_EXECUTE, 0, m->cycle, id_ex->pc - 1, id_ex->instruction, 0, 0);
+
+    // Without observers there is nothing to report, so skip the snapshot
+    if (m->hooks.active == 0)
     {
-    case ADD:
-        _ADD();
-        break;
-    case SUB:
-        _SUB();
-        break;
-    case MUL:
-        _MUL();
-        break;
-    case MOVI:
-        _MOVI();
-        break;
-    case BEQZ:
-        _BEQZ();
-        break;
-    case ANDI:
-        _ANDI();
-        break;
-    case EOR:
-        _EOR();
-        break;
-    case BR:
-        _BR();
-        break;
-    case SAL:
-        _SAL();
-        break;
-    case SAR:
-        _SAR();
-        break;
-    case LDR:
-        _LDR();
-        break;
-    case STR:
-        _STR();
+        opcode_func(m, id_ex);
+        scoreboard_writeback(&m->scoreboard, id_ex, m->register_file[id_ex->r1]);
+        if (m->trace != NULL)
+            trace_result(m, id_ex);
+        if (!isEmpty(&m->id_ex_queue))
+            dequeue_id_ex(&m->id_ex_queue);
+        return;
+    }
+
+    // The instruction's writes land in the dirty journal (hooks.h); SREG and
+    // PC are compared against their values before it
+    data_word_t old_SREG = read_sreg(m);
+    instruction_word_t old_PC = m->PC;
+    m->hooks.journal_count = 0;
+
+    opcode_func(m, id_ex);
+    scoreboard_writeback(&m->scoreboard, id_ex, m->register_file[id_ex->r1]);
+    if (m->trace != NULL)
+        trace_result(m, id_ex);
+
+    hooks_retire(m, id_ex->pc - 1, id_ex->instruction, old_SREG, old_PC);
+    if (!isEmpty(&m->id_ex_queue))
+        dequeue_id_ex(&m->id_ex_queue);
+}
+
+// Function to dispatch the instruction at the head of the ID/EX latch to its
+// handler. GCC and Clang jump straight through a table of label addresses
+// (computed goto); other compilers, or builds with SIM_DISPATCH_SWITCH, use
+// the portable switch. Both are expanded from the ISA table (isa.h).
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(SIM_DISPATCH_SWITCH)
+// The dispatch table is filled in ISA_OPCODES order, so the list must give
+// the encodings in order from 0
+enum
+{
+#define ISA_POSITION(name, opcode, format, signed_immediate, flags, operands) name##_position,
+    ISA_OPCODES(ISA_POSITION)
+#undef ISA_POSITION
+};
+#define ISA_IN_ORDER(name, opcode, format, signed_immediate, flags, operands) \
+    _Static_assert((opcode) == name##_position, "ISA_OPCODES must list the encodings in order from 0");
+ISA_OPCODES(ISA_IN_ORDER)
+#undef ISA_IN_ORDER
+#endif
+
+void opcode_func(machine_t *m, ID_EX *id_ex)
+{
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(SIM_DISPATCH_SWITCH)
+    // Each opcode's label in encoding order, then the undefined encodings;
+    // every slot is initialized once
+    static void *const dispatch_table[ISA_OPCODE_SLOTS] = {
+#define ISA_LABEL(name, opcode, format, signed_immediate, flags, operands) &&op_##name,
+        ISA_OPCODES(ISA_LABEL)
+#undef ISA_LABEL
+        [INVALID_INSTRUCTION ... ISA_OPCODE_SLOTS - 1] = &&op_invalid,
+    };
+
+    goto *dispatch_table[id_ex->opcode & 0xF];
+
+#define ISA_HANDLER(name, opcode, format, signed_immediate, flags, operands) \
+    op_##name:                                                     \
+    _##name(m, id_ex);                                             \
+    return;
+    ISA_OPCODES(ISA_HANDLER)
+#undef ISA_HANDLER
+op_invalid:
+    fprintf(stderr, "Error: Unknown opcode %d\n", id_ex->opcode);
+#else
+    switch (id_ex->opcode)
+    {
+#define ISA_CASE(name, opcode, format, signed_immediate, flags, operands) \
+    case name:                                                  \
+        _##name(m, id_ex);                                      \
         break;
+        ISA_OPCODES(ISA_CASE)
+#undef ISA_CASE
     default:
-        fprintf(stderr, "Error: Unknown opcode %d\n", id_ex.opcode);
+        fprintf(stderr, "Error: Unknown opcode %d\n", id_ex->opcode);
     }
-}
\ No newline at end of file
+#endif
+}
@@ -0,0 +1,96 @@
+#include <string.h>
+#include "predictor.h"
+#include "memory.h"
+
+static const char *const predictor_names[] = {
+    [PREDICT_NOT_TAKEN] = "not-taken",
+    [PREDICT_BACKWARD_TAKEN] = "backward-taken",
+    [PREDICT_TWO_BIT] = "2bit",
+};
+
+// Function to configure a predictor and clear its tables
+void predictor_init(predictor_t *predictor, predictor_kind_t kind, int counter_entries, int btb_entries)
+{
+    predictor->kind = kind;
+    predictor->counter_entries = (uint16_t)counter_entries;
+    predictor->btb_entries = (uint16_t)btb_entries;
+    predictor_reset(predictor);
+}
+
+// Function to clear the tables, keeping the configuration
+void predictor_reset(predictor_t *predictor)
+{
+    memset(predictor->counters, PREDICTOR_WEAKLY_TAKEN - 1, sizeof(predictor->counters)); // Weakly not taken
+    memset(predictor->btb, 0, sizeof(predictor->btb));
+}
+
+// Function to predict the instruction fetched after the one at pc
+int predict_branch(const predictor_t *predictor, uint16_t pc, const decoded_instr_t *uop, uint16_t *target)
+{
+    if (uop->opcode == BEQZ)
+    {
+        int taken;
+        if (predictor->kind == PREDICT_TWO_BIT)
+            taken = predictor->counters[pc & (predictor->counter_entries - 1)] >= PREDICTOR_WEAKLY_TAKEN;
+        else
+            taken = predictor->kind == PREDICT_BACKWARD_TAKEN && uop->immediate < 0;
+
+        // Same target as _BEQZ: the PC after the branch plus the offset
+        uint16_t destination = (uint16_t)(pc + 1 + uop->immediate);
+        if (!taken || destination >= INSTR_MEMORY_SIZE)
+            return 0;
+        *target = destination;
+        return 1;
+    }
+
+    if (uop->opcode == BR && predictor->btb_entries > 0)
+    {
+        const btb_entry_t *entry = &predictor->btb[pc & (predictor->btb_entries - 1)];
+        if (entry->valid && entry->pc == pc)
+        {
+            *target = entry->target;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to train the predictor with a resolved branch
+void predictor_update(predictor_t *predictor, uint16_t pc, Opcode opcode, int taken, uint16_t target)
+{
+    if (opcode == BEQZ && predictor->kind == PREDICT_TWO_BIT)
+    {
+        uint8_t *counter = &predictor->counters[pc & (predictor->counter_entries - 1)];
+        if (taken && *counter < 3)
+            (*counter)++;
+        else if (!taken && *counter > 0)
+            (*counter)--;
+    }
+    else if (opcode == BR && predictor->btb_entries > 0 && target < INSTR_MEMORY_SIZE)
+    {
+        btb_entry_t *entry = &predictor->btb[pc & (predictor->btb_entries - 1)];
+        entry->pc = pc;
+        entry->target = target;
+        entry->valid = 1;
+    }
+}
+
+// Function to parse a predictor name
+int parse_predictor(const char *name, predictor_kind_t *kind)
+{
+    for (int i = 0; i < (int)(sizeof(predictor_names) / sizeof(predictor_names[0])); i++)
+    {
+        if (strcmp(name, predictor_names[i]) == 0)
+        {
+            *kind = (predictor_kind_t)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to get the name of a predictor
+const char *get_predictor_name(predictor_kind_t kind)
+{
+    return predictor_names[kind];
+}
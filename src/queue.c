@@ -2,208 +2,117 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include "queue.h"
+#include "log.h"
 
-queue *createQueue()
+// Function to reset a latch to the empty state
+void init_queue(queue *q)
 {
-    queue *q = (queue *)malloc(sizeof(queue));
-    q->front = q->rear = NULL;
-    return q;
+    q->head = 0;
+    q->count = 0;
 }
 
-void enqueue_if_id(queue *q, IF_ID *if_id)
+// Helper function to claim the next free slot at the rear of the queue
+static uint32_t claim_slot(queue *q, const char *latch_name)
 {
-    // Create a copy of the IF_ID structure to avoid using stack memory
-    IF_ID *new_if_id = (IF_ID *)malloc(sizeof(IF_ID));
-    if (new_if_id == NULL)
+    if (q->count == QUEUE_CAPACITY)
     {
-        printf("Error: Failed to allocate memory for IF_ID structure\n");
+        fprintf(stderr, "Error: %s latch overflow (capacity %d)\n", latch_name, QUEUE_CAPACITY);
         exit(EXIT_FAILURE);
     }
 
-    // Copy the data
-    new_if_id->instr = if_id->instr;
-    new_if_id->pc = if_id->pc;
-    new_if_id->next = NULL;
+    uint32_t slot = (q->head + q->count) & QUEUE_MASK;
+    q->count++;
+    return slot;
+}
 
-    // Add the new entry to the queue
-    if (q->rear == NULL)
-    {
-        q->front = q->rear = new_if_id;
-    }
-    else
-    {
-        ((IF_ID *)q->rear)->next = new_if_id;
-        q->rear = new_if_id;
-    }
+void enqueue_if_id(queue *q, IF_ID *if_id)
+{
+    q->slots.if_id[claim_slot(q, "IF/ID")] = *if_id;
 }
 
 void enqueue_id_ex(queue *q, ID_EX *id_ex)
 {
-    // Create a copy of the ID_EX structure to avoid using stack memory
-    ID_EX *new_id_ex = (ID_EX *)malloc(sizeof(ID_EX));
-    if (new_id_ex == NULL)
-    {
-        printf("Error: Failed to allocate memory for ID_EX structure\n");
-        exit(EXIT_FAILURE);
-    }
-
-    // Copy the data
-    new_id_ex->instruction = id_ex->instruction;
-    new_id_ex->pc = id_ex->pc;
-    new_id_ex->opcode = id_ex->opcode;
-    new_id_ex->r1 = id_ex->r1;
-    new_id_ex->r2 = id_ex->r2;
-    new_id_ex->r1_value = id_ex->r1_value;
-    new_id_ex->r2_value = id_ex->r2_value;
-    new_id_ex->immediate = id_ex->immediate;
-    // Copy hazard-related fields
-    new_id_ex->data_hazard = id_ex->data_hazard;
-    new_id_ex->r1_forward = id_ex->r1_forward;
-    new_id_ex->r2_forward = id_ex->r2_forward;
-    new_id_ex->next = NULL;
-
-    // Add the new entry to the queue
-    if (q->rear == NULL)
-    {
-        q->front = q->rear = new_id_ex;
-    }
-    else
-    {
-        ((ID_EX *)q->rear)->next = new_id_ex;
-        q->rear = new_id_ex;
-    }
+    q->slots.id_ex[claim_slot(q, "ID/EX")] = *id_ex;
 }
 
+// The returned entry stays valid until the slot is reused by a later enqueue
 IF_ID *dequeue_if_id(queue *q)
 {
-    if (q->front == NULL)
+    if (q->count == 0)
     {
-        printf("Can't dequeue, queue is empty\n");
+        log_debug("Can't dequeue, queue is empty\n");
         return NULL;
     }
 
-    IF_ID *temp = q->front;
-    q->front = ((IF_ID *)q->front)->next;
-
-    if (q->front == NULL)
-    {
-        q->rear = NULL;
-    }
-
-    temp->next = NULL;
+    IF_ID *temp = &q->slots.if_id[q->head];
+    q->head = (q->head + 1) & QUEUE_MASK;
+    q->count--;
     return temp;
 }
 
 ID_EX *dequeue_id_ex(queue *q)
 {
-    if (q->front == NULL)
+    if (q->count == 0)
     {
-        printf("Can't dequeue, queue is empty\n");
+        log_debug("Can't dequeue, queue is empty\n");
         return NULL;
     }
 
-    ID_EX *temp = q->front;
-    q->front = ((ID_EX *)q->front)->next;
-
-    if (q->front == NULL)
-    {
-        q->rear = NULL;
-    }
-
-    temp->next = NULL;
+    ID_EX *temp = &q->slots.id_ex[q->head];
+    q->head = (q->head + 1) & QUEUE_MASK;
+    q->count--;
     return temp;
 }
 
 IF_ID *peek_if_id(queue *q)
 {
-    if (q->front == NULL)
+    if (q->count == 0)
     {
-        printf("No peek, queue is empty\n");
+        log_debug("No peek, queue is empty\n");
         return NULL;
     }
-    return q->front;
+    return &q->slots.if_id[q->head];
 }
 
 ID_EX *peek_id_ex(queue *q)
 {
-    if (q->front == NULL)
+    if (q->count == 0)
     {
-        printf("No peek, queue is empty\n");
+        log_debug("No peek, queue is empty\n");
         return NULL;
     }
-    return q->front;
-}
-
-int isEmpty(queue *q)
-{
-    return (q->front == NULL);
-}
-
-int getqueueSize_if_id(queue *q)
-{
-    int size = 0;
-    IF_ID *current = q->front;
-    while (current != NULL)
-    {
-        size++;
-        current = current->next;
-    }
-    return size;
+    return &q->slots.id_ex[q->head];
 }
 
-int getqueueSize_id_ex(queue *q)
+// Function to drop every entry in the latch (used on control hazards)
+void flush_queue(queue *q)
 {
-    int size = 0;
-    ID_EX *current = q->front;
-    while (current != NULL)
-    {
-        size++;
-        current = current->next;
-    }
-    return size;
+    q->head = 0;
+    q->count = 0;
 }
 
-void freequeue_if_id(queue *q)
+int isEmpty(queue *q)
 {
-    IF_ID *curr = q->front;
-    IF_ID *next;
-    while (curr != NULL)
-    {
-        next = curr->next;
-        free(curr);
-        curr = next;
-    }
-    free(q);
+    return (q->count == 0);
 }
 
-void freequeue_id_ex(queue *q)
+int getQueueSize_if_id(queue *q)
 {
-    ID_EX *curr = q->front;
-    ID_EX *next;
-    while (curr != NULL)
-    {
-        next = curr->next;
-        free(curr);
-        curr = next;
-    }
-    free(q);
+    return (int)q->count;
 }
 
-bool isqueueEmpty(queue *q)
+int getQueueSize_id_ex(queue *q)
 {
-    return q == NULL || q->front == NULL;
+    return (int)q->count;
 }
 
 // Function to print the contents of a queue
 void print_queue(queue *q)
 {
-
-    IF_ID *current = q->front;
     printf("Queue contents: ");
-    while (current != NULL)
+    for (uint32_t i = 0; i < q->count; i++)
     {
-        printf("0x%04X -> ", current->instr); 
-        current = current->next;
+        printf("0x%04X -> ", q->slots.if_id[(q->head + i) & QUEUE_MASK].instr);
     }
     printf("\n");
 }
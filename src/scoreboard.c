@@ -0,0 +1,51 @@
+#include <string.h>
+#include "scoreboard.h"
+
+// Function to set the scoreboard's timing for a 3- or 5-stage pipeline
+void scoreboard_configure(scoreboard_t *scoreboard, int stages)
+{
+    // The 3-stage pipeline loads in execute and writes back at its end. In
+    // the 5-stage one a load has its value after MEM, and WB, two cycles
+    // after execute, writes before decode reads in the same cycle
+    scoreboard->load_delay = stages > 3 ? 2 : SCOREBOARD_BYPASS_DELAY;
+    scoreboard->writeback_delay = stages > 3 ? 1 : 0;
+}
+
+// Function to clear the scoreboard: every register file entry is current
+void scoreboard_reset(scoreboard_t *scoreboard)
+{
+    memset(scoreboard->ready_cycle, 0, sizeof(scoreboard->ready_cycle));
+    memset(scoreboard->written_cycle, 0, sizeof(scoreboard->written_cycle));
+    memset(scoreboard->bypass, 0, sizeof(scoreboard->bypass));
+    memset(scoreboard->producer_pc, 0, sizeof(scoreboard->producer_pc));
+}
+
+// Function to forget the destinations of the instructions a flush is about to squash
+void scoreboard_squash(scoreboard_t *scoreboard, const queue *id_ex_latch)
+{
+    // They were issued last, so each one is still its register's entry;
+    // everything older than the branch has executed by now
+    for (uint32_t i = 1; i < id_ex_latch->count; i++)
+    {
+        const ID_EX *squashed = &id_ex_latch->slots.id_ex[(id_ex_latch->head + i) & QUEUE_MASK];
+        if (isa_table[squashed->opcode & 0xF].operands & ISA_WRITES_R1)
+        {
+            scoreboard->written_cycle[squashed->r1] = 0;
+            scoreboard->ready_cycle[squashed->r1] = 0;
+        }
+    }
+}
+
+// Function to push back the destinations still in flight when the pipeline freezes
+void scoreboard_delay(scoreboard_t *scoreboard, int cycle, int delay)
+{
+    // Their instructions execute delay cycles later than issue planned
+    for (int reg = 0; reg < REG_COUNT; reg++)
+    {
+        if (scoreboard->written_cycle[reg] > cycle)
+        {
+            scoreboard->written_cycle[reg] += delay;
+            scoreboard->ready_cycle[reg] += delay;
+        }
+    }
+}
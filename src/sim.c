@@ -0,0 +1,323 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "memory.h"
+#include "pipeline.h"
+#include "jit.h"
+#include "object.h"
+#include "assembler.h"
+#include "decoder.h"
+#include "flags.h"
+#include "file_map.h"
+#include "log.h"
+
+// Function to fill a configuration with the defaults
+void sim_default_config(sim_config_t *config)
+{
+    config->engine = SIM_ENGINE_PIPELINE;
+    config->max_cycles = 0;
+    config->predictor = PREDICT_NOT_TAKEN;
+    config->predictor_entries = PREDICTOR_DEFAULT_COUNTERS;
+    config->btb_entries = 0;
+    config->data_memory_size = DEFAULT_DATA_MEMORY_SIZE;
+    cache_default_config(&config->icache, 0);
+    cache_default_config(&config->dcache, 0);
+    config->issue_width = 1;
+    config->stages = 3;
+    config->cosim = 0;
+}
+
+// Helper function to parse a table size: a power of two from minimum to maximum
+static int parse_table_size(const char *text, int minimum, int maximum, int *size)
+{
+    char *end;
+    long value = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || value < minimum || value > maximum || (value & (value - 1)) != 0)
+        return 0;
+    *size = (int)value;
+    return 1;
+}
+
+// Helper function to parse a count from minimum to maximum
+static int parse_count(const char *text, int minimum, int maximum, int *count)
+{
+    char *end;
+    long value = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || value < minimum || value > maximum)
+        return 0;
+    *count = (int)value;
+    return 1;
+}
+
+// Function to apply one "--name=value" (or "--cosim") option to a configuration
+int sim_parse_option(sim_config_t *config, const char *option)
+{
+    if (strcmp(option, "--mode=pipeline") == 0)
+        config->engine = SIM_ENGINE_PIPELINE;
+    else if (strcmp(option, "--mode=functional") == 0)
+        config->engine = SIM_ENGINE_FUNCTIONAL;
+    else if (strcmp(option, "--mode=jit") == 0)
+        config->engine = SIM_ENGINE_JIT;
+    else if (strncmp(option, "--max-cycles=", 13) == 0)
+        config->max_cycles = strtoll(option + 13, NULL, 10);
+    else if (strncmp(option, "--predictor=", 12) == 0)
+        return parse_predictor(option + 12, &config->predictor);
+    else if (strncmp(option, "--predictor-entries=", 20) == 0)
+        return parse_table_size(option + 20, 1, PREDICTOR_MAX_COUNTERS, &config->predictor_entries);
+    else if (strncmp(option, "--btb=", 6) == 0)
+        return parse_table_size(option + 6, 0, PREDICTOR_MAX_BTB, &config->btb_entries);
+    else if (strncmp(option, "--data-memory=", 14) == 0)
+        return parse_table_size(option + 14, DATA_PAGE_SIZE, MAX_DATA_MEMORY_SIZE, &config->data_memory_size);
+    else if (strncmp(option, "--icache=", 9) == 0)
+        return parse_cache_config(option + 9, &config->icache);
+    else if (strncmp(option, "--dcache=", 9) == 0)
+        return parse_cache_config(option + 9, &config->dcache);
+    else if (strncmp(option, "--issue-width=", 14) == 0)
+        return parse_count(option + 14, 1, MAX_ISSUE_WIDTH, &config->issue_width);
+    else if (strcmp(option, "--stages=3") == 0)
+        config->stages = 3;
+    else if (strcmp(option, "--stages=5") == 0)
+        config->stages = 5;
+    else if (strcmp(option, "--cosim") == 0)
+        config->cosim = 1;
+    else
+        return 0;
+    return 1;
+}
+
+// Function to apply a configuration's machine options to a machine
+void sim_configure(machine_t *m, const sim_config_t *config)
+{
+    predictor_init(&m->predictor, config->predictor, config->predictor_entries, config->btb_entries);
+    cache_init(&m->icache, &config->icache);
+    cache_init(&m->dcache, &config->dcache);
+    m->issue_width = config->issue_width;
+    m->stages = config->stages;
+    scoreboard_configure(&m->scoreboard, config->stages);
+    if (m->data_memory_size != (uint32_t)config->data_memory_size)
+        set_data_memory_size(m, (uint32_t)config->data_memory_size);
+}
+
+// Function to create a machine with cleared memories; returns NULL on failure
+machine_t *sim_create(void)
+{
+    return machine_create();
+}
+
+// Function to destroy a machine created by sim_create
+void sim_destroy(machine_t *m)
+{
+    machine_destroy(m);
+}
+
+// Helper function to assemble the first program of a text file with the
+// bulk assembler; returns the number of instructions (0 on error)
+static uint16_t assemble_file(sim_image_t *image, const char *file_path)
+{
+    size_t size = 0;
+    const uint8_t *text = map_file(file_path, &size);
+    if (text == NULL)
+    {
+        fprintf(stderr, "[PARSER] Failed to open file: %s\n", file_path);
+        return 0;
+    }
+    log_summary("[PARSER]   Loading assembly from: %s\n", file_path);
+
+    asm_program_t program;
+    asm_scanner_t scanner;
+    asm_error_t error;
+    asm_init(&scanner, (const char *)text, size);
+    asm_status_t status = asm_next_program(&scanner, &program, &error);
+    unmap_file(text, size);
+
+    if (status != ASM_PROGRAM)
+    {
+        if (status == ASM_ERROR)
+            fprintf(stderr, "[PARSER] %s:%d: %s\n", file_path, error.line, error.message);
+        return 0;
+    }
+    sim_image_from_words(image, program.words, program.count);
+    log_summary("[PARSER] Successfully finished loading %d instructions into memory.\n", program.count);
+    return program.count;
+}
+
+// Function to assemble a program file into instruction memory
+uint16_t sim_load_file(machine_t *m, const char *file_path)
+{
+    sim_image_t *image = (sim_image_t *)malloc(sizeof(sim_image_t));
+    if (image == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate memory for program image\n");
+        return 0;
+    }
+
+    uint16_t count = assemble_file(image, file_path);
+    if (count > 0)
+        sim_load_image(m, image);
+    free(image);
+    return count;
+}
+
+// Function to copy already assembled instruction words into instruction memory
+uint16_t sim_load_program(machine_t *m, const instruction_word_t *words, uint16_t count)
+{
+    if (count > INSTR_MEMORY_SIZE)
+        count = INSTR_MEMORY_SIZE;
+
+    for (uint16_t address = 0; address < count; address++)
+    {
+        write_instruction(m, address, words[address]);
+        read_decoded_instruction(m, address); // Fill the pre-decoded copy up front
+    }
+    return count;
+}
+
+// Function to fill an image with already assembled instruction words
+void sim_image_from_words(sim_image_t *image, const instruction_word_t *words, uint16_t count)
+{
+    if (count > INSTR_MEMORY_SIZE)
+        count = INSTR_MEMORY_SIZE;
+
+    image->count = count;
+    for (uint16_t address = 0; address < INSTR_MEMORY_SIZE; address++)
+    {
+        if (address < count)
+        {
+            image->words[address] = words[address];
+            predecode_instruction(words[address], &image->decoded[address]);
+        }
+        else
+        {
+            image->words[address] = UNDEFINED_INT16;
+            image->decoded[address].valid = 0;
+        }
+    }
+    memset(image->data, 0, sizeof(image->data));
+    image->data_count = 0;
+}
+
+// Function to build an image from assembly text or an object file
+uint16_t sim_build_image(sim_image_t *image, const char *file_path)
+{
+    if (object_is_file(file_path))
+        return object_load_file(image, file_path);
+    return assemble_file(image, file_path);
+}
+
+// Function to replace the machine's instruction memory with an image
+void sim_load_image(machine_t *m, const sim_image_t *image)
+{
+    memcpy(m->instr_memory, image->words, sizeof(m->instr_memory));
+    memcpy(m->decoded_memory, image->decoded, sizeof(m->decoded_memory));
+    if (m->jit != NULL)
+        jit_init(m); // Every translated block belongs to the old program
+    sim_load_image_data(m, image);
+}
+
+// Function to apply an image's data initializers
+void sim_load_image_data(machine_t *m, const sim_image_t *image)
+{
+    if (image->data_count == 0)
+        return;
+
+    // Only pages with initializers get storage
+    static const data_word_t zeros[DATA_PAGE_SIZE];
+    for (uint32_t address = 0; address < IMAGE_DATA_SIZE; address += DATA_PAGE_SIZE)
+    {
+        if (memcmp(&image->data[address], zeros, DATA_PAGE_SIZE) == 0)
+            continue;
+        if (address >= m->data_memory_size)
+        {
+            fprintf(stderr, "Warning: Data initializers beyond the %u-byte data memory are dropped\n",
+                    m->data_memory_size);
+            return;
+        }
+        memcpy(touch_data_page(m, (uint16_t)address), &image->data[address], DATA_PAGE_SIZE);
+    }
+}
+
+// Function to clear registers, SREG and data memory and reset the pipeline
+void sim_reset(machine_t *m)
+{
+    init_data_memory(m);
+    init_register_file(m);
+    write_sreg(m, 0);
+    reset_pipeline(m); // Also resets the program counter
+}
+
+// Function to run one pipeline cycle; returns the machine's state after it
+int sim_step(machine_t *m)
+{
+    if (m->sys_call == 1)
+        pipeline_cycle(m);
+    return sim_is_running(m);
+}
+
+// Function to run the pipeline until the program drains, faults or max_cycles is exceeded
+fault_t sim_run(machine_t *m, long long max_cycles, long long *cycles)
+{
+    long long simulated_cycles = 0;
+    while (m->sys_call == 1) // Continue until all instructions are executed
+    {
+        simulated_cycles += pipeline_advance(m, max_cycles);
+
+        if (max_cycles > 0 && m->cycle > max_cycles)
+            break;
+    }
+    if (cycles != NULL)
+        *cycles = simulated_cycles;
+    return m->fault;
+}
+
+// Function to run the functional (ISA-level) engine from PC
+fault_t sim_run_functional(machine_t *m, long long max_instructions, functional_stats_t *stats)
+{
+    functional_run(m, max_instructions, stats);
+    return m->fault;
+}
+
+// Function to run the JIT engine from PC, setting it up on first use
+fault_t sim_run_jit(machine_t *m, long long max_instructions, functional_stats_t *stats)
+{
+    if (m->jit == NULL)
+        jit_init(m);
+    jit_run(m, max_instructions, stats);
+    return m->fault;
+}
+
+data_word_t sim_get_register(machine_t *m, uint8_t index)
+{
+    return read_register(m, index);
+}
+
+data_word_t sim_get_data(machine_t *m, uint16_t address)
+{
+    return read_data(m, address);
+}
+
+data_word_t sim_get_sreg(const machine_t *m)
+{
+    return read_sreg(m);
+}
+
+instruction_word_t sim_get_pc(const machine_t *m)
+{
+    return m->PC;
+}
+
+int sim_get_cycle(const machine_t *m)
+{
+    return m->cycle;
+}
+
+fault_t sim_get_fault(const machine_t *m)
+{
+    return m->fault;
+}
+
+int sim_is_running(const machine_t *m)
+{
+    if (m->fault != FAULT_NONE)
+        return SIM_FAULTED;
+    return m->sys_call == 1 ? SIM_RUNNING : SIM_STOPPED;
+}
@@ -0,0 +1,299 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include "trace.h"
+#include "decoder.h"
+
+#define TRACE_OUTPUT_SIZE 65536  // Encoded bytes the writer collects per fwrite
+#define TRACE_WRITER_BATCH 4096  // Records the writer encodes before freeing their slots
+#define TRACE_WRITER_SLEEP_NS 100000 // Writer back-off while the ring buffer is empty
+
+// Helper function to append a varint (7 bits per byte, low bits first)
+static uint8_t *put_varint(uint8_t *out, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+// Helper functions to map signed deltas to small unsigned numbers and back
+static uint32_t zigzag32(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static uint32_t zigzag16(uint16_t current, uint16_t previous)
+{
+    int16_t delta = (int16_t)(uint16_t)(current - previous);
+    return (uint16_t)(((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15));
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Helper function to encode one record against the one before it
+static uint8_t *encode_record(uint8_t *out, const trace_record_t *record, const trace_record_t *previous)
+{
+    *out++ = record->type;
+    *out++ = record->flags;
+    out = put_varint(out, zigzag32((int32_t)(record->cycle - previous->cycle)));
+    out = put_varint(out, zigzag16(record->pc, previous->pc));
+    out = put_varint(out, zigzag16(record->instruction, previous->instruction));
+    out = put_varint(out, zigzag16(record->address, previous->address));
+    out = put_varint(out, zigzag16((uint16_t)record->value, (uint16_t)previous->value));
+    return out;
+}
+
+// Writer thread: encode published records and write them out until the
+// trace is closed and the ring buffer is empty
+static void *writer_main(void *arg)
+{
+    trace_t *trace = (trace_t *)arg;
+    uint8_t *output = (uint8_t *)malloc(TRACE_OUTPUT_SIZE);
+    trace_record_t previous = {0};
+    unsigned long long tail = atomic_load_explicit(&trace->tail, memory_order_relaxed);
+    if (output == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate the trace output buffer\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (;;)
+    {
+        // Closing is read first, so a head read after it sees every record
+        int closing = atomic_load_explicit(&trace->closing, memory_order_acquire);
+        unsigned long long head = atomic_load_explicit(&trace->head, memory_order_acquire);
+        if (head == tail)
+        {
+            if (closing)
+                break;
+            struct timespec pause = {0, TRACE_WRITER_SLEEP_NS};
+            nanosleep(&pause, NULL);
+            continue;
+        }
+
+        if (head - tail > TRACE_WRITER_BATCH)
+            head = tail + TRACE_WRITER_BATCH;
+
+        uint8_t *out = output;
+        for (; tail < head; tail++)
+        {
+            const trace_record_t *record = &trace->records[tail & trace->mask];
+            out = encode_record(out, record, &previous);
+            previous = *record;
+            if (out - output > TRACE_OUTPUT_SIZE - TRACE_MAX_ENCODED_SIZE)
+            {
+                fwrite(output, 1, (size_t)(out - output), trace->file);
+                out = output;
+            }
+        }
+        atomic_store_explicit(&trace->tail, tail, memory_order_release);
+        fwrite(output, 1, (size_t)(out - output), trace->file);
+    }
+
+    free(output);
+    return NULL;
+}
+
+// Function to open a trace file and start its writer thread
+trace_t *trace_open(const char *path, int records)
+{
+    unsigned long long capacity = CACHE_LINE_SIZE; // Keeps the ring a whole number of cache lines
+    while (capacity < (unsigned long long)(records > 0 ? records : TRACE_DEFAULT_RECORDS))
+        capacity <<= 1;
+
+    trace_t *trace = (trace_t *)aligned_alloc(CACHE_LINE_SIZE, sizeof(trace_t));
+    trace_record_t *ring = (trace_record_t *)aligned_alloc(CACHE_LINE_SIZE, capacity * sizeof(trace_record_t));
+    FILE *file = fopen(path, "wb");
+    if (trace == NULL || ring == NULL || file == NULL)
+    {
+        fprintf(stderr, "Error: Could not open trace file %s\n", path);
+        free(trace);
+        free(ring);
+        if (file != NULL)
+            fclose(file);
+        return NULL;
+    }
+
+    memset(trace, 0, sizeof(*trace));
+    trace->records = ring;
+    trace->mask = capacity - 1;
+    trace->file = file;
+    atomic_init(&trace->head, 0);
+    atomic_init(&trace->tail, 0);
+    atomic_init(&trace->closing, 0);
+
+    uint8_t version = TRACE_VERSION;
+    fwrite(TRACE_MAGIC, 1, TRACE_MAGIC_SIZE, file);
+    fwrite(&version, 1, 1, file);
+
+    if (pthread_create(&trace->thread, NULL, writer_main, trace) != 0)
+    {
+        fprintf(stderr, "Error: Failed to start the trace writer\n");
+        fclose(file);
+        free(ring);
+        free(trace);
+        return NULL;
+    }
+    return trace;
+}
+
+// Function to drain the ring buffer, stop the writer and close the file
+long long trace_close(trace_t *trace)
+{
+    if (trace == NULL)
+        return 0;
+
+    atomic_store_explicit(&trace->closing, 1, memory_order_release);
+    pthread_join(trace->thread, NULL);
+    long long records = (long long)atomic_load(&trace->tail);
+    if (fclose(trace->file) != 0)
+        fprintf(stderr, "Error: Failed to write the trace file\n");
+    free(trace->records);
+    free(trace);
+    return records;
+}
+
+// Function to wait until the writer has made room in a full ring buffer
+void trace_wait(trace_t *trace)
+{
+    unsigned long long head = atomic_load_explicit(&trace->head, memory_order_relaxed);
+    for (;;)
+    {
+        trace->tail_seen = atomic_load_explicit(&trace->tail, memory_order_acquire);
+        if (head - trace->tail_seen <= trace->mask)
+            return;
+        sched_yield();
+    }
+}
+
+// Function to open a trace file for reading
+int trace_reader_open(trace_reader_t *reader, const char *path)
+{
+    memset(reader, 0, sizeof(*reader));
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL)
+    {
+        fprintf(stderr, "Error: Could not open trace file %s\n", path);
+        return 0;
+    }
+
+    char magic[TRACE_MAGIC_SIZE];
+    if (fread(magic, 1, TRACE_MAGIC_SIZE, reader->file) != TRACE_MAGIC_SIZE ||
+        memcmp(magic, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0 || fgetc(reader->file) != TRACE_VERSION)
+    {
+        fprintf(stderr, "Error: %s is not a version %d trace file\n", path, TRACE_VERSION);
+        fclose(reader->file);
+        reader->file = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+// Helper function to read a varint; returns 0 if the file ends inside it
+static int get_varint(FILE *file, uint32_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        int byte = fgetc(file);
+        if (byte == EOF)
+            return 0;
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// Function to read the next record
+int trace_read(trace_reader_t *reader, trace_record_t *record)
+{
+    int type = fgetc(reader->file);
+    if (type == EOF)
+        return 0;
+
+    int flags = fgetc(reader->file);
+    uint32_t fields[5];
+    for (int i = 0; i < 5; i++)
+    {
+        if (flags == EOF || !get_varint(reader->file, &fields[i]))
+            return -1;
+    }
+    if (type >= TRACE_EVENT_TYPES)
+        return -1;
+
+    const trace_record_t *previous = &reader->previous;
+    memset(record, 0, sizeof(*record));
+    record->type = (uint8_t)type;
+    record->flags = (uint8_t)flags;
+    record->cycle = previous->cycle + (uint32_t)unzigzag(fields[0]);
+    record->pc = (uint16_t)(previous->pc + unzigzag(fields[1]));
+    record->instruction = (uint16_t)(previous->instruction + unzigzag(fields[2]));
+    record->address = (uint16_t)(previous->address + unzigzag(fields[3]));
+    record->value = (int16_t)(uint16_t)((uint16_t)previous->value + unzigzag(fields[4]));
+    reader->previous = *record;
+    return 1;
+}
+
+// Function to close a trace reader
+void trace_reader_close(trace_reader_t *reader)
+{
+    if (reader->file != NULL)
+        fclose(reader->file);
+    reader->file = NULL;
+}
+
+// Function to format a record as one line of text
+const char *trace_format(const trace_record_t *record, char *buffer, int size)
+{
+    static const char *stall_names[TRACE_STALL_KINDS] = {"decode bubble", "execute bubble", "data hazard",
+                                                         "I-cache miss", "D-cache miss"};
+    const char *mnemonic = get_opcode_mnemonic((uint8_t)(record->instruction >> 12));
+
+    switch (record->type)
+    {
+    case TRACE_FETCH:
+        if (record->flags & TRACE_PREDICTED_TAKEN)
+            snprintf(buffer, (size_t)size, "%u IF PC %u 0x%04X %s predicted taken -> %u", record->cycle,
+                     record->pc, record->instruction, mnemonic, record->address);
+        else
+            snprintf(buffer, (size_t)size, "%u IF PC %u 0x%04X %s", record->cycle, record->pc,
+                     record->instruction, mnemonic);
+        break;
+    case TRACE_DECODE:
+        snprintf(buffer, (size_t)size, "%u ID PC %u 0x%04X %s%s%s", record->cycle, record->pc, record->instruction,
+                 mnemonic, (record->flags & TRACE_FORWARD_R1) ? " forward R1" : "",
+                 (record->flags & TRACE_FORWARD_R2) ? " forward R2" : "");
+        break;
+    case TRACE_EXECUTE:
+        snprintf(buffer, (size_t)size, "%u EX PC %u 0x%04X %s", record->cycle, record->pc, record->instruction,
+                 mnemonic);
+        break;
+    case TRACE_REGISTER:
+        snprintf(buffer, (size_t)size, "%u EX R%u = %d", record->cycle, record->address, record->value);
+        break;
+    case TRACE_MEMORY:
+        snprintf(buffer, (size_t)size, "%u EX Data[%u] = %d", record->cycle, record->address, record->value);
+        break;
+    case TRACE_FLUSH:
+        snprintf(buffer, (size_t)size, "%u EX flush, %d squashed, refetch from PC %u", record->cycle,
+                 record->value, record->pc);
+        break;
+    case TRACE_STALL:
+        snprintf(buffer, (size_t)size, "%u stall: %s (%d cycles left)", record->cycle,
+                 record->flags < TRACE_STALL_KINDS ? stall_names[record->flags] : "unknown", record->value);
+        break;
+    default:
+        snprintf(buffer, (size_t)size, "%u unknown event %u", record->cycle, record->type);
+        break;
+    }
+    return buffer;
+}
@@ -0,0 +1,132 @@
+// Build-time generator for the mnemonic lookup: searches for a multiplier
+// that hashes every mnemonic of the ISA table (isa.h) to its own slot and
+// writes the table as a header. Usage: isa_gen <output header>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "isa.h"
+
+typedef struct
+{
+    const char *mnemonic;
+    int opcode;
+} entry_t;
+
+#define ISA_ENTRY(name, opcode, format, signed_immediate, flags, operands) {#name, opcode},
+static const entry_t entries[] = {ISA_OPCODES(ISA_ENTRY)};
+#undef ISA_ENTRY
+
+#define ENTRY_COUNT (int)(sizeof(entries) / sizeof(entries[0]))
+#define MAX_BITS 12
+
+// Function to step a 64-bit splitmix generator for candidate multipliers
+static uint64_t next_candidate(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return (z ^ (z >> 31)) | 1;
+}
+
+// Function to check that a multiplier sends every key to a distinct slot
+static int is_perfect(const uint64_t *keys, uint64_t multiplier, int bits, int *slots)
+{
+    static unsigned char used[1 << MAX_BITS];
+    memset(used, 0, (size_t)1 << bits);
+    for (int i = 0; i < ENTRY_COUNT; i++)
+    {
+        uint32_t slot = isa_hash_slot(keys[i], multiplier, bits);
+        if (used[slot])
+            return 0;
+        used[slot] = 1;
+        slots[i] = (int)slot;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <output header>\n", argv[0]);
+        return 1;
+    }
+
+    uint64_t keys[ENTRY_COUNT];
+    int slots[ENTRY_COUNT];
+    for (int i = 0; i < ENTRY_COUNT; i++)
+    {
+        keys[i] = isa_mnemonic_key(entries[i].mnemonic, strlen(entries[i].mnemonic));
+        if (keys[i] == 0)
+        {
+            fprintf(stderr, "Error: Mnemonic '%s' is longer than %d characters\n",
+                    entries[i].mnemonic, ISA_MAX_MNEMONIC_LENGTH);
+            return 1;
+        }
+    }
+
+    // Smallest power-of-two table with at least one free slot per key,
+    // growing it whenever a fixed number of tries finds no perfect multiplier
+    int bits = 1;
+    while ((1 << bits) < 2 * ENTRY_COUNT)
+        bits++;
+
+    uint64_t state = 0;
+    uint64_t multiplier = 0;
+    while (multiplier == 0 && bits <= MAX_BITS)
+    {
+        for (int attempt = 0; attempt < 100000 && multiplier == 0; attempt++)
+        {
+            uint64_t candidate = next_candidate(&state);
+            if (is_perfect(keys, candidate, bits, slots))
+                multiplier = candidate;
+        }
+        if (multiplier == 0)
+            bits++;
+    }
+    if (multiplier == 0)
+    {
+        fprintf(stderr, "Error: No perfect hash found for the mnemonics\n");
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "w");
+    if (!file)
+    {
+        fprintf(stderr, "Error: Failed to create %s\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(file, "// Generated by tools/isa_gen.c from isa.h; do not edit\n");
+    fprintf(file, "#ifndef ISA_HASH_H\n#define ISA_HASH_H\n\n");
+    fprintf(file, "#define ISA_HASH_MULTIPLIER 0x%016llXull\n", (unsigned long long)multiplier);
+    fprintf(file, "#define ISA_HASH_BITS %d\n\n", bits);
+    fprintf(file, "// Key of the mnemonic in each slot (0: empty) and its opcode\n");
+    fprintf(file, "static const uint64_t isa_hash_keys[1 << ISA_HASH_BITS] = {\n");
+    for (int slot = 0; slot < (1 << bits); slot++)
+    {
+        int i = 0;
+        while (i < ENTRY_COUNT && slots[i] != slot)
+            i++;
+        if (i < ENTRY_COUNT)
+            fprintf(file, "    0x%016llXull, // %s\n", (unsigned long long)keys[i], entries[i].mnemonic);
+        else
+            fprintf(file, "    0,\n");
+    }
+    fprintf(file, "};\n\nstatic const uint8_t isa_hash_opcodes[1 << ISA_HASH_BITS] = {\n");
+    for (int slot = 0; slot < (1 << bits); slot++)
+    {
+        int i = 0;
+        while (i < ENTRY_COUNT && slots[i] != slot)
+            i++;
+        fprintf(file, "    %d,\n", i < ENTRY_COUNT ? entries[i].opcode : 0);
+    }
+    fprintf(file, "};\n\n#endif // ISA_HASH_H\n");
+
+    if (fclose(file) != 0)
+    {
+        fprintf(stderr, "Error: Failed to write %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
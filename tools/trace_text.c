@@ -0,0 +1,31 @@
+// Offline converter for binary pipeline traces (trace.h): prints one line
+// of text per record. Usage: trace_text <trace file>
+#include <stdio.h>
+#include "trace.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <trace file>\n", argv[0]);
+        return 1;
+    }
+
+    trace_reader_t reader;
+    if (!trace_reader_open(&reader, argv[1]))
+        return 1;
+
+    trace_record_t record;
+    char line[128];
+    int status;
+    while ((status = trace_read(&reader, &record)) > 0)
+        printf("%s\n", trace_format(&record, line, sizeof(line)));
+    trace_reader_close(&reader);
+
+    if (status < 0)
+    {
+        fprintf(stderr, "Error: %s is truncated or corrupt\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}